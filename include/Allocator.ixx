@@ -23,4 +23,22 @@ class MemoryAllocator final {
 
   VmaAllocator getAllocator() const noexcept;
 };
+
+// raw device memory that isn't bound to any resource, used to place several resources in the same memory
+class MemoryAllocation final {
+ private:
+  const MemoryAllocator* _memoryAllocator;
+  VmaAllocation _allocation;
+
+ public:
+  MemoryAllocation(const VkMemoryRequirements& memoryRequirements, const MemoryAllocator& memoryAllocator);
+  MemoryAllocation(const MemoryAllocation&) = delete;
+  MemoryAllocation& operator=(const MemoryAllocation&) = delete;
+  MemoryAllocation(MemoryAllocation&&) = delete;
+  MemoryAllocation& operator=(MemoryAllocation&&) = delete;
+  ~MemoryAllocation();
+
+  VmaAllocation getAllocation() const noexcept;
+  VkDeviceSize getSize() const noexcept;
+};
 }  // namespace RenderGraph
\ No newline at end of file
@@ -21,6 +21,10 @@ class Buffer final {
   VmaAllocation _allocation;
   VmaAllocationInfo _allocationInfo;
   VkDeviceSize _size;
+  VkBufferUsageFlags _usage;
+  VmaAllocationCreateFlags _flags;
+  // keeps shared memory alive while buffer is bound to it
+  std::shared_ptr<MemoryAllocation> _memoryAliasing;
   std::unique_ptr<Buffer> _bufferStaging;
   static constexpr VkPipelineStageFlags VK_PIPELINE_STAGE_ALL_SHADER_BITS =
       VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
@@ -37,11 +41,21 @@ class Buffer final {
   Buffer& operator=(Buffer&&) = delete;
 
   void setData(std::span<const std::byte> data, const CommandBuffer& commandBufferTransfer);
+  // recreate buffer in device local memory that can be shared with other resources, content is lost and data is
+  // uploaded through staging buffer from now on
+  void createAliasingBuffer(std::shared_ptr<MemoryAllocation> memoryAllocation);
+  // recreate buffer with its own allocation after it was aliased, content is lost
+  void createOwnBuffer();
+  bool isAliased() const noexcept;
+  // own allocation is mappable, false for aliased buffer
+  bool isHostVisible() const noexcept;
   VkBuffer getBuffer() const noexcept;
   VkDeviceSize getSize() const noexcept;
   const VmaAllocationInfo& getAllocationInfo() const noexcept;
   VmaAllocation getAllocation() const noexcept;
   VkDeviceAddress getDeviceAddress(const Device& device) const noexcept;
+  VkMemoryRequirements getMemoryRequirements(const Device& device) const noexcept;
+  const MemoryAllocator& getMemoryAllocator() const noexcept;
   ~Buffer();
 };
 }  // namespace RenderGraph
\ No newline at end of file
@@ -12,13 +12,19 @@ class CommandBuffer final {
   bool _active = false;
 
  public:
-  CommandBuffer(const CommandPool& pool, const Device& device);
+  CommandBuffer(const CommandPool& pool,
+                const Device& device,
+                VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
   CommandBuffer(CommandBuffer&& commandBuffer) noexcept;
   CommandBuffer(const CommandBuffer&) = delete;
   CommandBuffer& operator=(const CommandBuffer&) = delete;
   CommandBuffer& operator=(CommandBuffer&&) = delete;
 
   void beginCommands() noexcept;
+  // without VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT command buffer can be submitted again
+  void beginCommands(VkCommandBufferUsageFlags flags) noexcept;
+  // for secondary command buffer
+  void beginCommands(const VkCommandBufferInheritanceInfo& inheritanceInfo) noexcept;
   void endCommands() noexcept;
   bool getActive() const noexcept;
   const VkCommandBuffer& getCommandBuffer() const noexcept;
@@ -3,6 +3,10 @@ import Instance;
 import Surface;
 import <VkBootstrap.h>;
 import <volk.h>;
+import <deque>;
+import <memory>;
+import <mutex>;
+import <string>;
 
 export namespace RenderGraph {
 class Device final {
@@ -11,9 +15,23 @@ class Device final {
   VkPhysicalDeviceProperties _deviceProperties;
   VkPhysicalDeviceDescriptorBufferPropertiesEXT _descriptorBufferProperties;
   std::vector<VkQueueFamilyProperties> _queueFamilyProperties;
+  bool _calibratedTimestamps = false;
+  // calibrateable time domains, empty without VK_EXT_calibrated_timestamps
+  std::vector<VkTimeDomainEXT> _timeDomains;
+  bool _pipelineStatistics = false;
+  // shared by all pipelines
+  VkPipelineCache _pipelineCache = VK_NULL_HANDLE;
+  // deferred destruction, values don't decrease from front to back. Device is shared as const, resources are queued
+  // from any thread.
+  mutable std::mutex _mutexDestroy;
+  mutable std::deque<std::pair<uint64_t, std::shared_ptr<void>>> _destroyQueue;
+  // surface is nullptr for headless device
+  Device(const Instance& instance, const Surface* surface);
 
  public:
   Device(const Surface& surface, const Instance& instance);
+  // headless device without present support, any GPU type is accepted (including software ones like lavapipe)
+  explicit Device(const Instance& instance);
   Device(const Device&) = delete;
   Device& operator=(const Device&) = delete;
   Device(Device&&) = delete;
@@ -29,6 +47,24 @@ class Device final {
   const VkPhysicalDeviceProperties& getDeviceProperties() const noexcept;
   const VkPhysicalDeviceDescriptorBufferPropertiesEXT& getDescriptorBufferProperties() const noexcept;
   const VkQueueFamilyProperties& getQueueFamilyProperties(vkb::QueueType type) const noexcept;
+  // VK_EXT_calibrated_timestamps with device time domain
+  bool isCalibratedTimestamps() const noexcept;
+  const std::vector<VkTimeDomainEXT>& getTimeDomains() const noexcept;
+  // pipelineStatisticsQuery feature
+  bool isPipelineStatistics() const noexcept;
+  // empty until it's loaded
+  VkPipelineCache getPipelineCache() const noexcept;
+  // false if file is missing or was written for another GPU or driver (vendor, device, pipeline cache UUID), cache
+  // stays as is then. Loaded pipelines are merged to the cache. Pipelines can't be created while it's loaded.
+  bool loadPipelineCache(std::string_view path);
+  // written to temporary file that replaces the old one, so interrupted write doesn't leave broken cache
+  void savePipelineCache(std::string_view path) const;
+  // take ownership of resource (Buffer, Image, Sampler, ...) and destroy it once GPU reaches value of in-flight
+  // timeline it was last used with (Graph::getFrameValue), so it can be dropped without waiting for device idle
+  void destroyDeferred(std::shared_ptr<void> resource, uint64_t value) const;
+  // destroy everything GPU has passed, value is the last finished value of in-flight timeline
+  void destroyCompleted(uint64_t value) const;
+  int getDestroyQueueSize() const;
 
   ~Device();
 };
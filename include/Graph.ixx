@@ -5,21 +5,62 @@ import Texture;
 import Swapchain;
 import Sync;
 import Timestamps;
+import Trace;
+import Statistics;
+import PipelineStatistics;
 import Command;
 import CommandPool;
 import Buffer;
 import Device;
 import Window;
+import Allocator;
+import Workers;
 import glm;
 import <volk.h>;
-import "BS_thread_pool.hpp";
+import <VkBootstrap.h>;
 import <map>;
+import <set>;
+import <atomic>;
+import <chrono>;
 
 export namespace RenderGraph {
+struct AliasingStatistics {
+  // memory needed if every transient resource has its own allocation
+  VkDeviceSize naiveSize = 0;
+  // memory actually allocated for transient resources after aliasing
+  VkDeviceSize peakSize = 0;
+};
+
+// how pass uses resource, barriers between passes are built from it
+struct ResourceAccess {
+  bool image = true;
+  VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE;
+  VkAccessFlags2 accessRead = VK_ACCESS_2_NONE;
+  VkAccessFlags2 accessWrite = VK_ACCESS_2_NONE;
+};
+
+// index of resource in GraphStorage returned when resource is added, names are kept only for lookup and debugging
+struct ImageHandle {
+  int index = -1;
+  bool operator==(const ImageHandle&) const = default;
+};
+
+struct BufferHandle {
+  int index = -1;
+  bool operator==(const BufferHandle&) const = default;
+};
+
 class GraphStorage final {
  private:
-  std::map<std::string, std::unique_ptr<ImageViewHolder>> _imageViewHolders;
-  std::map<std::string, std::vector<std::unique_ptr<Buffer>>> _buffers;
+  // resources are never removed, so handles stay valid after resource is replaced or graph is reset
+  std::vector<std::unique_ptr<ImageViewHolder>> _imageViewHolders;
+  std::vector<std::vector<std::unique_ptr<Buffer>>> _buffers;
+  std::vector<std::string> _imageNames, _bufferNames;
+  // std::less<> allows lookup by std::string_view without creating std::string
+  std::map<std::string, ImageHandle, std::less<>> _imageHandles;
+  std::map<std::string, BufferHandle, std::less<>> _bufferHandles;
+  std::set<std::string> _transient, _exported;
+  std::set<std::string> _aliasedImages, _aliasedBuffers, _restored;
 
  public:
   GraphStorage() = default;
@@ -28,21 +69,58 @@ class GraphStorage final {
   GraphStorage(GraphStorage&&) = delete;
   GraphStorage& operator=(GraphStorage&&) = delete;
 
-  void add(std::string_view name, std::unique_ptr<ImageViewHolder> imageViewHolder) noexcept;
+  // resource with the same name is replaced and keeps its handle
+  ImageHandle add(std::string_view name, std::unique_ptr<ImageViewHolder> imageViewHolder) noexcept;
   // not const because will do std::move
-  void add(std::string_view name, std::vector<std::unique_ptr<Buffer>>& buffers) noexcept;
-  void reset(
-             std::vector<std::shared_ptr<ImageView>> oldSwapchain,
-             std::vector<std::shared_ptr<ImageView>> newSwapchain,
-             const CommandBuffer& commandBuffer) noexcept;
+  BufferHandle add(std::string_view name, std::vector<std::unique_ptr<Buffer>>& buffers) noexcept;
+  // invalid handle (index -1) if there is no such resource
+  ImageHandle getImageHandle(std::string_view name) const noexcept;
+  BufferHandle getBufferHandle(std::string_view name) const noexcept;
+  const std::string& getName(ImageHandle handle) const noexcept;
+  const std::string& getName(BufferHandle handle) const noexcept;
+  // transient resource doesn't keep content between frames, so it can share memory with other transient resources
+  void setTransient(std::string_view name) noexcept;
+  // exported resource is consumed outside of the graph, so passes that write to it are never culled
+  void setExported(std::string_view name) noexcept;
+  const std::set<std::string>& getExported() const noexcept;
+  const std::set<std::string>& getTransient() const noexcept;
+  // lifetimes: first and last index of pass in execution order that uses resource
+  // recreateBuffers: buffers don't change on reset, so their aliasing stays the same and they aren't touched while
+  // frames in flight use them
+  AliasingStatistics alias(const std::map<std::string, glm::ivec2>& lifetimes,
+                           const Device& device,
+                           bool recreateBuffers = true);
+  const std::set<std::string>& getAliasedImages() const noexcept;
+  const std::set<std::string>& getAliasedBuffers() const noexcept;
+  // resources that left shared memory in the last alias and got their own memory back, content is lost and images
+  // are in VK_IMAGE_LAYOUT_UNDEFINED
+  const std::set<std::string>& getRestored() const noexcept;
+  // images are replaced instead of being recreated in place, the old ones are returned because frames in flight can
+  // still use them
+  std::vector<std::shared_ptr<ImageView>> reset(std::vector<std::shared_ptr<ImageView>> oldSwapchain,
+                                                std::vector<std::shared_ptr<ImageView>> newSwapchain,
+                                                const CommandBuffer& commandBuffer) noexcept;
   std::string find(const std::vector<std::shared_ptr<ImageView>>& imageViews) noexcept;
-  const ImageViewHolder& getImageViewHolder(std::string_view name) const noexcept;
+  const ImageViewHolder& getImageViewHolder(ImageHandle handle) const noexcept;
+  // throws if there is no such resource
+  const ImageViewHolder& getImageViewHolder(std::string_view name) const;
   // NVRO
-  std::vector<Buffer*> getBuffer(std::string_view name) const noexcept;
+  std::vector<Buffer*> getBuffer(BufferHandle handle) const noexcept;
+  // throws if there is no such resource
+  std::vector<Buffer*> getBuffer(std::string_view name) const;
 };
 
 class GraphElement {
+ private:
+  std::atomic<uint64_t> _version = 0;
+
  public:
+  // content of element has changed, so static pass it belongs to has to be recorded again
+  void markDirty() noexcept;
+  uint64_t getVersion() const noexcept;
+  // opt-in, element is drawn in its own rendering scope instead of the one shared by all elements of the pass.
+  // Ignored by parallel recording.
+  virtual bool isRenderingScopeSeparate() const noexcept;
   virtual void draw(int currentFrame, const CommandBuffer& commandBuffer) = 0;
   virtual void update(int currentFrame, const CommandBuffer& commandBuffer) = 0;
   virtual void reset(const std::vector<std::shared_ptr<RenderGraph::ImageView>>& swapchain,
@@ -57,31 +135,113 @@ class GraphPass {
   std::string _name;
   GraphPassType _graphPassType;
   const GraphStorage* _graphStorage;
+  const Device* _device;
   std::unique_ptr<CommandPool> _commandPool;
   std::vector<std::unique_ptr<CommandBuffer>> _commandBuffers;
+  // parallel recording: elements are split to chunks, every chunk is recorded by its own thread to secondary command
+  // buffers from its own command pool
+  std::unique_ptr<Workers> _workersChunks;
+  std::vector<std::unique_ptr<CommandPool>> _commandPoolsChunk;
+  // [chunk][frame in flight]
+  std::vector<std::vector<std::unique_ptr<CommandBuffer>>> _commandBuffersUpdate, _commandBuffersDraw;
+  // recording of chunk, preallocated so dispatching it to workers doesn't allocate
+  struct ChunkTask final : Task {
+    GraphPass* pass = nullptr;
+    int chunk = 0;
+    int currentFrame = 0;
+    bool update = false;
+    const VkCommandBufferInheritanceInfo* inheritanceDraw = nullptr;
+    Timestamps* timestamps = nullptr;
+    void execute() override;
+  };
+  std::vector<ChunkTask> _chunkTasks;
+  // chunks not recorded yet, the last recorded chunk wakes up the thread waiting for them
+  std::atomic<int> _chunksRemaining = 0;
+  // secondary command buffers of chunks passed to vkCmdExecuteCommands
+  std::vector<VkCommandBuffer> _commandBuffersExecute;
+  // static pass is recorded once for every frame in flight and swapchain image and resubmitted until it's changed
+  bool _static = false;
+  uint64_t _version = 0;
+  std::vector<std::unique_ptr<CommandBuffer>> _commandBuffersStatic;
+  // version of pass every static command buffer is recorded with
+  std::vector<std::optional<uint64_t>> _versionsStatic;
   std::vector<std::pair<std::vector<std::shared_ptr<Semaphore>>, std::function<int()>>> _signalSemaphores,
       _waitSemaphores;
+  // stage at which every wait semaphore blocks the pass
+  std::vector<VkPipelineStageFlags2> _waitStages;
   std::vector<std::shared_ptr<GraphElement>> _graphElements;
+  // every element draw is measured by its own scope nested in pass timestamps
+  bool _elementTimestamps = false;
+  std::vector<std::string> _elementNames;
+
+  // inheritanceDraw describes rendering draw buffers are executed in
+  void _recordChunks(int currentFrame,
+                     bool update,
+                     const VkCommandBufferInheritanceInfo& inheritanceDraw,
+                     Timestamps* timestamps);
+  void _drawElement(int index, int currentFrame, const CommandBuffer& commandBuffer, Timestamps* timestamps);
+  void _executeChunks(int currentFrame, bool update, const CommandBuffer& commandBuffer);
 
  public:
-  GraphPass(std::string_view name, GraphPassType graphPassType, const GraphStorage& graphStorage) noexcept;
+  GraphPass(std::string_view name,
+            GraphPassType graphPassType,
+            const GraphStorage& graphStorage,
+            const Device& device) noexcept;
   GraphPass(const GraphPass&) = delete;
   GraphPass& operator=(const GraphPass&) = delete;
   GraphPass(GraphPass&&) = delete;
   GraphPass& operator=(GraphPass&&) = delete;
 
   void registerGraphElement(std::shared_ptr<GraphElement> graphElement) noexcept;
+  // opt-in, elements are recorded by threadsNumber threads, so they must be safe to record concurrently. 0 disables.
+  void setParallelRecording(int threadsNumber);
+  bool isParallelRecording() const noexcept;
+  // elements of static pass are recorded only after pass or any of its elements is marked dirty, it isn't measured by
+  // timestamps. Has to be set before Graph::calculate.
+  void setStatic(bool value) noexcept;
+  bool isStatic() const noexcept;
+  // opt-in, has to be set before Graph::calculate
+  void setElementTimestamps(bool value) noexcept;
+  bool isElementTimestamps() const noexcept;
+  // names element scopes, returns number of scopes pass records every frame
+  int compileTimestamps();
+  void markDirty() noexcept;
+  // changes every time pass or any of its elements is marked dirty or new element is registered
+  uint64_t getVersion() const noexcept;
+  // number: frames in flight * swapchain images, pass is recorded again. Command buffers that aren't needed anymore are
+  // returned because GPU can still execute them.
+  std::vector<std::unique_ptr<CommandBuffer>> allocateCommandBuffersStatic(int number);
+  // nullptr if pass isn't static
+  CommandBuffer* getCommandBufferStatic(int index) const noexcept;
+  bool isRecorded(int index) const noexcept;
+  void setRecorded(int index) noexcept;
   // not const because will do std::move
   void addSignalSemaphore(std::vector<std::shared_ptr<Semaphore>>& signalSemaphore,
                           std::function<int()> index) noexcept;
-  void addWaitSemaphore(std::vector<std::shared_ptr<Semaphore>>& waitSemaphore, std::function<int()> index) noexcept;
+  void addWaitSemaphore(std::vector<std::shared_ptr<Semaphore>>& waitSemaphore,
+                        std::function<int()> index,
+                        VkPipelineStageFlags2 waitStage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT) noexcept;
+  // semaphores are added by Graph::calculate, so they are dropped before it runs again
+  void clearSemaphores() noexcept;
   // NVRO
   GraphPassType getGraphPassType() const noexcept;
   std::vector<Semaphore*> getSignalSemaphores() const noexcept;
   std::vector<Semaphore*> getWaitSemaphores() const noexcept;
+  // the same without allocation, used by render
+  int getSignalSemaphoreNumber() const noexcept;
+  Semaphore* getSignalSemaphore(int index) const noexcept;
+  int getWaitSemaphoreNumber() const noexcept;
+  Semaphore* getWaitSemaphore(int index) const noexcept;
+  const std::vector<VkPipelineStageFlags2>& getWaitStages() const noexcept;
   std::vector<CommandBuffer*> getCommandBuffers() const noexcept;
-  std::string getName() const noexcept;
-  virtual void execute(int currentFrame, const CommandBuffer& commandBuffer) = 0;
+  CommandBuffer* getCommandBuffer(int frameInFlight) const noexcept;
+  const std::string& getName() const noexcept;
+  // names of resources pass reads from / writes to
+  virtual std::vector<std::string> getInputs() const noexcept = 0;
+  virtual std::vector<std::string> getOutputs() const noexcept = 0;
+  virtual std::map<std::string, ResourceAccess> getResourceAccesses() const noexcept = 0;
+  // timestamps is nullptr if pass isn't measured this frame
+  virtual void execute(int currentFrame, const CommandBuffer& commandBuffer, Timestamps* timestamps) = 0;
   void reset(const std::vector<std::shared_ptr<RenderGraph::ImageView>>& swapchain, CommandBuffer& commandBuffer);
   virtual ~GraphPass() = default;
 };
@@ -91,9 +251,28 @@ class GraphPassGraphic final : public GraphPass {
   std::vector<std::string> _colorTargets, _textureInputs;
   std::optional<std::string> _depthTarget;
 
-  std::map<std::string, bool> _clearTarget;
+  // clear value is default (black for color, 1 for depth) if not set
+  std::map<std::string, std::optional<VkClearValue>> _clearTarget;
   std::unique_ptr<PipelineGraphic> _pipelineGraphic;
-  const Device* _device;
+  // everything needed to begin rendering, attachments are described once instead of every frame
+  struct RenderingPlan {
+    std::vector<VkRenderingAttachmentInfo> colorAttachments;
+    VkRenderingAttachmentInfo depthAttachment{};
+    std::vector<VkFormat> colorFormats;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    VkRenderingInfo renderingInfo{};
+    // the same with attachments loaded instead of cleared
+    std::vector<VkRenderingAttachmentInfo> colorAttachmentsLoad;
+    VkRenderingAttachmentInfo depthAttachmentLoad{};
+    VkRenderingInfo renderingInfoLoad{};
+  };
+  // [frameInFlight * _swapchainImages + swapchain index]
+  std::vector<RenderingPlan> _renderingPlans;
+  // set if pass renders to swapchain, otherwise plan is the same for all swapchain images
+  std::optional<ImageHandle> _swapchain;
+  int _swapchainImages = 1;
+  std::vector<ImageHandle> _colorHandles;
+  std::optional<ImageHandle> _depthHandle;
 
  public:
   GraphPassGraphic(std::string_view name,
@@ -111,14 +290,29 @@ class GraphPassGraphic final : public GraphPass {
   // handle input to shaders
   void addTextureInput(std::string_view name) noexcept;
 
-  // clear color target before use or load
-  void clearTarget(std::string_view name) noexcept;
+  // clear target before use instead of load
+  void clearTarget(std::string_view name, std::optional<VkClearValue> clearValue = std::nullopt) noexcept;
+  bool isCleared(std::string_view name) const noexcept;
 
   const std::vector<std::string>& getColorTargets() const noexcept;
   std::optional<std::string> getDepthTarget() const noexcept;
   const std::vector<std::string>& getTextureInputs() const noexcept;
   PipelineGraphic& getPipelineGraphic(const GraphStorage& graphStorage) const noexcept;
-  void execute(int currentFrame, const CommandBuffer& commandBuffer) override;
+  // resolves targets and builds rendering plans, has to be called after targets are added to storage and every time
+  // they are recreated. discardBefore / discardAfter: targets whose content before / after the pass isn't needed.
+  void compile(int maxFramesInFlight,
+               ImageHandle swapchain,
+               const std::set<std::string>& discardBefore,
+               const std::set<std::string>& discardAfter) noexcept;
+  // copies of targets are picked by index function of their holders when pass is recorded (it isn't necessarily
+  // frame in flight, e.g. history ping-pong), static pass is marked dirty if it was recorded with other copies
+  void updateAttachments(int currentFrame, int swapchainIndex) noexcept;
+  // compiled attachments with inferred load and store operations
+  const VkRenderingInfo& getRenderingInfo(int currentFrame, int swapchainIndex) const noexcept;
+  std::vector<std::string> getInputs() const noexcept override;
+  std::vector<std::string> getOutputs() const noexcept override;
+  std::map<std::string, ResourceAccess> getResourceAccesses() const noexcept override;
+  void execute(int currentFrame, const CommandBuffer& commandBuffer, Timestamps* timestamps) override;
 };
 
 class GraphPassCompute final : public GraphPass {
@@ -126,7 +320,6 @@ class GraphPassCompute final : public GraphPass {
   std::vector<std::string> _storageBufferInputs, _storageBufferOutputs;
   std::vector<std::string> _storageTextureInputs, _storageTextureOutputs;
   bool _separate = false;
-  const Device* _device;
 
  public:
   GraphPassCompute(std::string_view name,
@@ -151,18 +344,30 @@ class GraphPassCompute final : public GraphPass {
   const std::vector<std::string>& getStorageTextureInputs() const noexcept;
   const std::vector<std::string>& getStorageTextureOutputs() const noexcept;
   bool isSeparate() const noexcept;
-  void execute(int currentFrame, const CommandBuffer& commandBuffer) override;
+  std::vector<std::string> getInputs() const noexcept override;
+  std::vector<std::string> getOutputs() const noexcept override;
+  std::map<std::string, ResourceAccess> getResourceAccesses() const noexcept override;
+  void execute(int currentFrame, const CommandBuffer& commandBuffer, Timestamps* timestamps) override;
 };
 
 class Graph final {
  private:
-  Swapchain* _swapchain;
+  // nullptr for headless graph
+  Swapchain* _swapchain = nullptr;
   const Device* _device;
-  const Window* _window;
-  std::unique_ptr<BS::thread_pool> _threadPool;
+  const Window* _window = nullptr;
+  // nullptr if passes are recorded by thread calling render
+  std::unique_ptr<Workers> _workers;
   std::vector<std::unique_ptr<GraphPass>> _passes;
   std::deque<GraphPass*> _passesOrdered;
+  // passes whose outputs are never consumed, they aren't recorded and submitted
+  std::vector<GraphPass*> _passesCulled;
   std::unique_ptr<Timestamps> _timestamps;
+  Trace* _trace = nullptr;
+  std::unique_ptr<FrameStatistics> _statistics;
+  int _statisticsWindow = 120;
+  // nullptr if pipeline statistics aren't enabled
+  std::unique_ptr<PipelineStatistics> _pipelineStatistics;
   std::unique_ptr<GraphStorage> _graphStorage;
   std::unique_ptr<CommandPool> _commandPoolReset;
   std::unique_ptr<CommandBuffer> _commandBuffersReset;
@@ -170,19 +375,121 @@ class Graph final {
   // special semaphores
   std::vector<std::shared_ptr<Semaphore>> _semaphoreRenderFinished, _semaphoreImageAvailable;
   std::unique_ptr<Semaphore> _semaphoreInFlight;
+  // the last pass of the queue that doesn't submit the frame's last pass signals it
+  std::vector<std::shared_ptr<Semaphore>> _semaphoreJoin;
   uint64_t _valueSemaphoreInFlight = 1;
+  // per frame resources are allocated for _maxFramesInFlight, CPU waits when it's _framesInFlightLimit frames ahead
   int _maxFramesInFlight;
+  int _framesInFlightLimit;
   int _frameInFlight = 0;
+  // 0 -> frame limiter is off
+  std::chrono::nanoseconds _frameTime{0};
+  std::chrono::steady_clock::time_point _frameDeadline;
+
+  // resource has to be synchronized with its previous use on the same queue before the pass
+  struct ResourceBarrier {
+    std::string name;
+    bool image = true;
+    VkPipelineStageFlags2 srcStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+    VkPipelineStageFlags2 dstStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 dstAccess = VK_ACCESS_2_NONE;
+  };
+
+  // barriers recorded by one call at the beginning of pass
+  struct BarrierBatch {
+    std::vector<VkMemoryBarrier2> memoryBarriers;
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+  };
 
   struct Cache {
-    bool queueTypeChange = false;
+    // command buffers accumulated before this pass are submitted first
+    bool newSubmission = false;
     GraphPass* previousPass = nullptr;
+    // passes that have to finish before this pass (data dependencies and write after read)
+    std::vector<GraphPass*> dependencies;
+    // pass waits for pass from the other queue
+    bool waitQueue = false;
+    std::map<std::string, ResourceAccess> accesses;
+    std::vector<ResourceBarrier> barriers;
+    // compiled barriers for every frame in flight and swapchain image: frameInFlight * _swapchainImages + index
+    std::vector<BarrierBatch> barrierBatches;
+    // pass waits for swapchain image and changes its layout
+    bool acquireSwapchain = false;
+    // pass accesses swapchain, so it can be recorded only after swapchain image is acquired
+    bool swapchainDependent = false;
+    // aliased resources which are used for the first time in this pass, their previous content is garbage
+    std::vector<std::string> aliasedImages;
+    bool aliasedBuffers = false;
+  };
+
+  // submissions of frame, consecutive submissions to the same queue are passed to one vkQueueSubmit2
+  struct Submission {
+    vkb::QueueType queueType = vkb::QueueType::graphics;
+    std::vector<VkCommandBufferSubmitInfo> commandBuffers;
+    std::vector<VkSemaphoreSubmitInfo> waitSemaphores;
+    std::vector<VkSemaphoreSubmitInfo> signalSemaphores;
+  };
+  // reused between frames, so steady state frame doesn't allocate: only the first _submissionNumber are valid
+  std::vector<Submission> _submissions;
+  int _submissionNumber = 0;
+  std::vector<VkSubmitInfo2> _submitInfos;
+  // recording of pass, preallocated so dispatching it to workers doesn't allocate
+  struct RecordTask final : Task {
+    Graph* graph = nullptr;
+    GraphPass* pass = nullptr;
+    CommandBuffer* commandBuffer = nullptr;
+    // index of pass in _passesOrdered is its slot in query pool
+    int index = 0;
+    bool timestamps = false;
+    // CPU time of the last recording in ns, < 0 if it's already added to statistics
+    double recordTime = -1;
+    std::atomic<bool> done = true;
+    void execute() override;
   };
+  // for every ordered pass
+  std::unique_ptr<RecordTask[]> _recordTasks;
 
   std::map<GraphPass*, Cache> _cache;
+  std::string _nameSwapchain;
+  // the last use of swapchain in frame, layout transition to present waits for it
+  ResourceAccess _swapchainAccessLast;
+  GraphPass* _passSwapchainLast = nullptr;
+  // passes before the one that acquires swapchain are submitted before the acquire
+  int _indexAcquire = 0;
+  // for every swapchain image
+  std::vector<VkImageMemoryBarrier2> _barriersPresent;
+  int _swapchainImages = 0;
+  std::map<std::string, glm::ivec2> _lifetimes;
+  // resources used by separate compute passes
+  std::set<std::string> _resourcesAsync;
+  AliasingStatistics _aliasingStatistics;
+  void _alias(bool recreateBuffers = true);
+  // rendering plans of graphic passes
+  void _compileRendering();
+  void _compileBarriers();
+  // static command buffers reference resources and barriers, so they have to be recorded again
+  std::vector<std::unique_ptr<CommandBuffer>> _invalidateStatic();
+  // static command buffer for the current frame in flight and swapchain image or ordinary one
+  CommandBuffer* _getCommandBuffer(GraphPass* pass, int swapchainIndex) const noexcept;
+  // waits till frames in flight of all iterations are free, frees resources of finished frames
+  void _beginFrame(int iterations);
+  // index of pass in _passesOrdered
+  void _recordPass(int index, int swapchainIndex, bool timestamps);
+  void _endCommandsReset();
+  void _waitPass(int index);
+  Submission& _addSubmission(vkb::QueueType queueType);
+  // adds recorded pass to the current submission or starts a new one
+  void _submitPass(GraphPass* pass, int swapchainIndex);
+  // the frame is finished when both queues are finished, only the last iteration of batch signals timeline
+  void _submitFrameEnd(bool signal);
+  void _flushSubmissions();
 
  public:
+  // threadsNumber 0 -> passes are recorded by thread calling render
   Graph(int threadsNumber, int maxFramesInFlight, Swapchain& swapchain, const Window& window, const Device& device) noexcept;
+  // headless graph renders to graph storage only: nothing is acquired and presented, render() never asks for reset
+  Graph(int threadsNumber, int maxFramesInFlight, const Device& device) noexcept;
   Graph(const Graph&) = delete;
   Graph& operator=(const Graph&) = delete;
   Graph(Graph&&) = delete;
@@ -194,14 +501,50 @@ class Graph final {
   GraphPassGraphic* getPassGraphic(std::string_view name) const noexcept;
   GraphPassCompute* getPassCompute(std::string_view name) const noexcept;
   GraphStorage& getGraphStorage() const noexcept;
-  std::map<std::string, glm::dvec2> getTimestamps() const noexcept;
+  // results of the latest finished frame, they lag behind render by up to frames in flight. In-flight timeline value
+  // of the frame is written to frame.
+  std::map<std::string, glm::dvec2> getTimestamps(uint64_t* frame = nullptr) const noexcept;
   int getFrameInFlight() const noexcept;
+  bool isHeadless() const noexcept;
+  // value in-flight timeline reaches when the frame being recorded (or the next one) is finished, resources used in it
+  // can be passed to Device::destroyDeferred with this value
+  uint64_t getFrameValue() const noexcept;
+  // fewer frames in flight reduce latency, per frame resources stay allocated for the number passed to constructor
+  void setMaxFramesInFlight(int maxFramesInFlight);
+  int getMaxFramesInFlight() const noexcept;
+  // render waits till frame time passes since the previous frame, 0 disables limiter
+  void setFrameTime(std::chrono::nanoseconds frameTime) noexcept;
+  // CPU spans of render and GPU spans of passes are added to trace, nullptr disables. Trace has to outlive graph or be
+  // unset before it's destroyed.
+  void setTrace(Trace* trace);
+  // number of the latest frames statistics are kept for. Has to be set before Graph::calculate.
+  void setStatisticsWindow(int frames);
+  // opt-in, throws if device doesn't support pipeline statistics queries. Has to be set before Graph::calculate.
+  void setPipelineStatistics(bool value);
+  bool isPipelineStatistics() const noexcept;
+  // per pass name, lags behind render the same as timestamps. Static passes and passes recorded in parallel aren't
+  // measured, passes on compute queue count only compute invocations.
+  std::map<std::string, PassStatistics> getPipelineStatistics(uint64_t* frame = nullptr) const noexcept;
+  // durations in ns, CPU frame is the time render takes, GPU frame is from the first pass start to the last pass end.
+  // GPU ones lag behind render the same as timestamps.
+  Percentiles getPassStatisticsGPU(std::string_view name) const noexcept;
+  Percentiles getPassStatisticsCPU(std::string_view name) const noexcept;
+  Percentiles getFrameStatisticsGPU() const noexcept;
+  Percentiles getFrameStatisticsCPU() const noexcept;
+  AliasingStatistics getAliasingStatistics() const noexcept;
+  const std::vector<GraphPass*>& getPassesCulled() const noexcept;
 
+  // throws if passes form a cycle or culling leaves no pass to render. Can be called again after render (e.g. to
+  // switch passes on and off), it waits for submitted frames then.
   void calculate();
   // true -> need to call reset
   bool render();
+  // headless only: records iterations of graph, each with its own frame in flight, and submits them together with
+  // one timeline signal at the end, iterations can't exceed frames in flight limit
+  void renderBatch(int iterations);
   void reset();
 
   void print() const noexcept;
+  ~Graph();
 };
 }  // namespace RenderGraph
\ No newline at end of file
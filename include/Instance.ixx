@@ -11,7 +11,8 @@ class Instance final {
   bool _debugUtils = false;
 
  public:
-  Instance(std::string_view name, bool validation);
+  // headless instance doesn't enable surface extensions, Device is created without Surface then
+  Instance(std::string_view name, bool validation, bool headless = false);
   Instance(const Instance&) = delete;
   Instance& operator=(const Instance&) = delete;
   Instance(Instance&&) = delete;
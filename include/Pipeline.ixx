@@ -8,8 +8,17 @@ import <map>;
 import <string>;
 import <optional>;
 import <ranges>;
+import <chrono>;
 
 export namespace RenderGraph {
+// VkPipelineCreationFeedback, filled only if driver reports it
+struct PipelineFeedback {
+  bool valid = false;
+  // pipeline was created from cache without compiling it
+  bool cacheHit = false;
+  std::chrono::nanoseconds duration{0};
+};
+
 class PipelineGraphic final {
  private:
   VkPipelineDynamicStateCreateInfo _dynamicState;
@@ -65,6 +74,8 @@ class Pipeline final {
   std::map<std::string, VkPushConstantRange> _pushConstants;
   VkPipeline _pipeline;
   VkPipelineLayout _pipelineLayout;
+  PipelineFeedback _feedback;
+  void _setFeedback(const VkPipelineCreationFeedback& feedback) noexcept;
 
  public:
   Pipeline(const Device& device) noexcept;
@@ -86,6 +97,7 @@ class Pipeline final {
   const std::map<std::string, VkPushConstantRange>& getPushConstants() const noexcept;
   const VkPipeline& getPipeline() const noexcept;
   const VkPipelineLayout& getPipelineLayout() const noexcept;
+  const PipelineFeedback& getFeedback() const noexcept;
   ~Pipeline();
 };
 }  // namespace RenderGraph
\ No newline at end of file
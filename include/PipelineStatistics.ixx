@@ -0,0 +1,70 @@
+export module PipelineStatistics;
+import Device;
+import Command;
+import <volk.h>;
+import <map>;
+import <memory>;
+import <mutex>;
+import <string>;
+import <vector>;
+
+export namespace RenderGraph {
+struct PassStatistics {
+  uint64_t vertexInvocations = 0;
+  uint64_t clippingPrimitives = 0;
+  uint64_t fragmentInvocations = 0;
+  uint64_t computeInvocations = 0;
+};
+
+// one query per pass, read back without waiting the same way as timestamps: pool is split to slices for every frame
+// in flight
+class PipelineStatistics final {
+ private:
+  const Device* _device;
+  // compute queue can't count graphics statistics, so passes on it have their own pool with compute invocations only
+  VkQueryPool _queryPoolGraphics = VK_NULL_HANDLE;
+  VkQueryPool _queryPoolCompute = VK_NULL_HANDLE;
+  std::vector<std::string> _passNames;
+  std::vector<uint8_t> _passesCompute;
+  struct Frame {
+    std::vector<uint8_t> passWritten;
+    uint64_t frameNumber = 0;
+    bool pending = false;
+  };
+  std::unique_ptr<Frame[]> _frames;
+  int _framesInFlight = 0;
+  int _frameInFlight = 0;
+  std::map<std::string, PassStatistics, std::less<>> _results;
+  uint64_t _resultsFrame = 0;
+  // values and availability for every query of slice
+  std::vector<uint64_t> _queryResultsGraphics, _queryResultsCompute;
+  std::mutex _mutexRequest;
+
+  void _destroyQueryPools() noexcept;
+  // false if frame isn't finished yet, force reads whatever is available
+  bool _readFrame(int frameInFlight, bool force);
+  void _poll();
+
+ public:
+  // throws if device doesn't support pipeline statistics queries
+  explicit PipelineStatistics(const Device& device);
+  PipelineStatistics(const PipelineStatistics&) = delete;
+  PipelineStatistics& operator=(const PipelineStatistics&) = delete;
+  PipelineStatistics(PipelineStatistics&&) = delete;
+  PipelineStatistics& operator=(PipelineStatistics&&) = delete;
+
+  // passesCompute: pass is executed on compute queue. Graph has to be idle.
+  void initialize(const std::vector<std::string>& passNames,
+                  const std::vector<uint8_t>& passesCompute,
+                  int framesInFlight);
+  void beginFrame(int frameInFlight, uint64_t frameNumber);
+  void endFrame();
+  void discardFrame();
+  // query can't be active while secondary command buffers are executed, so passes recorded in parallel aren't measured
+  void beginPass(int index, const CommandBuffer& commandBuffer) noexcept;
+  void endPass(int index, const CommandBuffer& commandBuffer) noexcept;
+  // results of the latest finished frame, in-flight timeline value of the frame is written to frame
+  std::map<std::string, PassStatistics> getPipelineStatistics(uint64_t* frame = nullptr);
+  ~PipelineStatistics();
+};
+}  // namespace RenderGraph
\ No newline at end of file
@@ -0,0 +1,54 @@
+export module Statistics;
+import <mutex>;
+import <string>;
+import <vector>;
+
+export namespace RenderGraph {
+// over the window of the latest samples, in ns
+struct Percentiles {
+  double p50 = 0;
+  double p95 = 0;
+  double p99 = 0;
+  double max = 0;
+  double mean = 0;
+  int samples = 0;
+};
+
+// ring of the latest samples, percentiles are computed on query in preallocated scratch storage
+class RollingStatistics final {
+ private:
+  std::vector<double> _samples;
+  int _index = 0;
+  int _number = 0;
+  mutable std::vector<double> _scratch;
+
+ public:
+  explicit RollingStatistics(int window);
+  void add(double value) noexcept;
+  Percentiles get() const noexcept;
+};
+
+// per pass and whole frame durations, CPU samples are added by render and GPU ones when timestamps are read back
+class FrameStatistics final {
+ private:
+  std::vector<std::string> _passNames;
+  std::vector<RollingStatistics> _passesGPU, _passesCPU;
+  RollingStatistics _frameGPU{1}, _frameCPU{1};
+  mutable std::mutex _mutex;
+
+  int _findPass(std::string_view name) const noexcept;
+
+ public:
+  // window: number of the latest frames samples are kept for
+  void initialize(const std::vector<std::string>& passNames, int window);
+  void addPassGPU(int index, double duration) noexcept;
+  void addPassCPU(int index, double duration) noexcept;
+  void addFrameGPU(double duration) noexcept;
+  void addFrameCPU(double duration) noexcept;
+  // no samples for unknown pass
+  Percentiles getPassGPU(std::string_view name) const noexcept;
+  Percentiles getPassCPU(std::string_view name) const noexcept;
+  Percentiles getFrameGPU() const noexcept;
+  Percentiles getFrameCPU() const noexcept;
+};
+}  // namespace RenderGraph
\ No newline at end of file
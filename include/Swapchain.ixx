@@ -8,6 +8,7 @@ import glm;
 import <volk.h>;
 import <VkBootstrap.h>;
 import <memory>;
+import <deque>;
 
 export namespace RenderGraph{class Swapchain {
  private:
@@ -17,11 +18,21 @@ export namespace RenderGraph{class Swapchain {
   uint32_t _swapchainIndex = 0;
   VkFormat _swapchainFormat = VK_FORMAT_R8G8B8A8_UNORM;
   std::vector<std::shared_ptr<ImageView>> _imageViews;
-  bool _verticalSync = false;
+  // swapchains replaced by reset, the oldest one goes first
+  std::deque<vkb::Swapchain> _swapchainsRetired;
+  // requested parameters, presentation engine can't be asked for unsupported ones
+  VkPresentModeKHR _presentMode;
+  int _minImageCount;
+  vkb::SwapchainBuilder _getBuilder(glm::ivec2 resolution) const noexcept;
   void _destroy();
 
  public:
-  Swapchain(glm::ivec2 resolution, const MemoryAllocator& allocator, const Device& device);
+  // minImageCount 0 -> the least number of images presentation engine needs + 1
+  Swapchain(glm::ivec2 resolution,
+            const MemoryAllocator& allocator,
+            const Device& device,
+            VkPresentModeKHR presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR,
+            int minImageCount = 0);
   Swapchain(const Swapchain&) = delete;
   Swapchain& operator=(const Swapchain&) = delete;
   Swapchain(Swapchain&&) = delete;
@@ -29,7 +40,17 @@ export namespace RenderGraph{class Swapchain {
 
   void initialize();
   VkResult acquireNextImage(const Semaphore& semaphore) noexcept;
+  // old swapchain is passed as oldSwapchain and stays alive (retired) because frames in flight can still use it
   std::vector<std::shared_ptr<ImageView>> reset(glm::ivec2 resolution);
+  // destroy the oldest retired swapchain, has to be called once for every reset after GPU is done with it
+  void destroyRetired() noexcept;
+  int getRetiredCount() const noexcept;
+  // applied by the next reset, FIFO is used if present mode isn't supported
+  void setPresentMode(VkPresentModeKHR presentMode) noexcept;
+  // applied by the next reset, clamped to what surface supports
+  void setMinImageCount(int minImageCount) noexcept;
+  // present mode of the current swapchain
+  VkPresentModeKHR getPresentMode() const noexcept;
 
   // to be able change layout
   Image& getImage(int index) const noexcept;
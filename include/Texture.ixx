@@ -54,6 +54,9 @@ class Image final {
   VkImageAspectFlags _aspectMask;
   VkImageUsageFlags _usageFlags;
   VkImageLayout _imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  // keeps shared memory alive while image is bound to it
+  std::shared_ptr<MemoryAllocation> _memoryAliasing;
+  VkImageCreateInfo _getImageCreateInfo() const noexcept;
 
  public:
   Image(const MemoryAllocator& memoryAllocator);
@@ -68,6 +71,13 @@ class Image final {
                    int layerNumber,
                    VkImageAspectFlags aspectMask,
                    VkImageUsageFlags usage);
+  // recreate image with the same parameters in memory that can be shared with other resources, content is lost and
+  // layout becomes VK_IMAGE_LAYOUT_UNDEFINED
+  void createAliasingImage(std::shared_ptr<MemoryAllocation> memoryAllocation);
+  // recreate image with its own memory after it was aliased, content is lost and layout becomes
+  // VK_IMAGE_LAYOUT_UNDEFINED
+  void createOwnImage();
+  bool isAliased() const noexcept;
   void wrapImage(const VkImage& existingImage,
                  VkFormat format,
                  glm::ivec2 resolution,
@@ -85,6 +95,20 @@ class Image final {
                     VkAccessFlags srcAccessMask,
                     VkAccessFlags dstAccessMask,
                     const CommandBuffer& commandBuffer);
+  void changeLayout(VkImageLayout oldLayout,
+                    VkImageLayout newLayout,
+                    VkPipelineStageFlags2 srcStageMask,
+                    VkAccessFlags2 srcAccessMask,
+                    VkPipelineStageFlags2 dstStageMask,
+                    VkAccessFlags2 dstAccessMask,
+                    const CommandBuffer& commandBuffer);
+  // barrier for the whole image, isn't recorded so several barriers can be submitted at once
+  VkImageMemoryBarrier2 getBarrier(VkImageLayout oldLayout,
+                                   VkImageLayout newLayout,
+                                   VkPipelineStageFlags2 srcStageMask,
+                                   VkAccessFlags2 srcAccessMask,
+                                   VkPipelineStageFlags2 dstStageMask,
+                                   VkAccessFlags2 dstAccessMask) const noexcept;
   void overrideLayout(VkImageLayout layout);
   void generateMipmaps(const CommandBuffer& commandBuffer);
 
@@ -96,6 +120,8 @@ class Image final {
   int getLayerNumber() const noexcept;
   VkImageAspectFlags getAspectMask() const noexcept;
   VkImageUsageFlags getUsageFlags() const noexcept;
+  VkMemoryRequirements getMemoryRequirements(const Device& device) const noexcept;
+  const MemoryAllocator& getMemoryAllocator() const noexcept;
   void destroy();
 
   ~Image();
@@ -128,6 +154,7 @@ class ImageView final {
   VkImageViewType getType() const noexcept;
   int getBaseMipMap() const noexcept;
   int getBaseArrayLayer() const noexcept;
+  const Device& getDevice() const noexcept;
   void destroy();
   ~ImageView();
 };
@@ -144,6 +171,8 @@ class ImageViewHolder final {
   ImageViewHolder& operator=(ImageViewHolder&&) = delete;
 
   void setImageViews(std::vector<std::shared_ptr<ImageView>> imageViews);
+  // replace i-th copy, the previous one is returned so it can be kept alive while GPU uses it
+  std::shared_ptr<ImageView> setImageView(int index, std::shared_ptr<ImageView> imageView);
   const ImageView& getImageView() const noexcept;
   std::function<int()> getIndexFunction() const noexcept;
   int getIndex() const noexcept;
@@ -1,32 +1,93 @@
 export module Timestamps;
 import Device;
 import Command;
+import Trace;
+import Statistics;
 import glm;
 import <volk.h>;
+import <atomic>;
 import <map>;
+import <memory>;
 import <string>;
 import <mutex>;
+import <optional>;
+import <vector>;
 
 export namespace RenderGraph {
 class Timestamps {
  private:
   const Device* _device;
   double _timestampPeriod;
-  int _queryMaxNumber = 30;
-  VkQueryPool _queryPool;
-  std::map<std::string, glm::ivec2> _timestampRanges;
-  std::map<std::string, glm::dvec2> _timestampResults;
-  int _timestampIndex = 0;
-  std::mutex _mutexPush, _mutexRequest;
+  // one slice of pool for every frame in flight, slice is read back only when its frame is finished, so CPU never
+  // waits for GPU. In slice [0, 2 * passes) are assigned to passes, the rest is handed out to scopes.
+  VkQueryPool _queryPool = VK_NULL_HANDLE;
+  int _querySliceNumber = 0;
+  std::vector<std::string> _passNames;
+  // queue every pass is executed on, GPU spans of trace are grouped by it
+  std::vector<std::string> _passTracks;
+  Trace* _trace = nullptr;
+  FrameStatistics* _statistics = nullptr;
+  struct Scope {
+    std::string_view name;
+    int query = 0;
+  };
+  struct Frame {
+    // every pass is recorded by one thread, so its flag isn't shared (not vector<bool> because of that)
+    std::vector<uint8_t> passWritten;
+    std::vector<Scope> scopes;
+    std::atomic<int> scopeIndex = 0;
+    uint64_t frameNumber = 0;
+    // submitted and not read back yet
+    bool pending = false;
+  };
+  std::unique_ptr<Frame[]> _frames;
+  int _framesInFlight = 0;
+  int _frameInFlight = 0;
+  // entries are kept between frames and looked up by string_view, so steady state doesn't allocate. Second is the
+  // number of read back that wrote entry, name that isn't measured anymore is dropped.
+  std::map<std::string, std::pair<glm::dvec2, uint64_t>, std::less<>> _timestampResults;
+  uint64_t _readNumber = 0;
+  uint64_t _resultsFrame = 0;
+  // value and availability for every query of slice
+  std::vector<uint64_t> _queryResults;
+  std::mutex _mutexRequest;
+
+  void _destroyQueryPool() noexcept;
+  void _setResult(std::string_view name, int query);
+  // false if frame isn't finished yet, force reads whatever is available
+  bool _readFrame(int frameInFlight, bool force);
+  // reads finished frames from the oldest one
+  void _poll();
 
  public:
   Timestamps(const Device& device);
-  void resetQueryPool() noexcept;
-  void pushTimestamp(std::string_view name, const CommandBuffer& commandBuffer);
-  void popTimestamp(std::string_view name, const CommandBuffer& commandBuffer);
-  void fetchTimestamps();
-  // return copy, otherwise race condition between calling code and fetchTimestamps
-  std::map<std::string, glm::dvec2> getTimestamps();
+  // query pool has two queries for every pass and for every scope of every frame in flight. Graph has to be idle.
+  void initialize(const std::vector<std::string>& passNames,
+                  const std::vector<std::string>& passTracks,
+                  int scopeNumber,
+                  int framesInFlight);
+  // every frame read back is added to trace, nullptr disables
+  void setTrace(Trace* trace);
+  // GPU durations of every read back pass and frame are added to statistics
+  void setStatistics(FrameStatistics* statistics);
+  // host steady clock ns = device ns + offset, nullopt without VK_EXT_calibrated_timestamps
+  std::optional<int64_t> getCalibration() const;
+  // slice of frame in flight is free: frame that used it before is finished, so it's read back without waiting
+  void beginFrame(int frameInFlight, uint64_t frameNumber);
+  // frame is submitted, its slice is read back as soon as GPU finishes it
+  void endFrame();
+  // frame is dropped before submission, written timestamps are never going to be available
+  void discardFrame();
+  // queries of pass are fixed, so passes recorded by different threads don't synchronize
+  void beginPass(int index, const CommandBuffer& commandBuffer) noexcept;
+  void endPass(int index, const CommandBuffer& commandBuffer) noexcept;
+  // scope is nested in pass, its queries are taken from the shared counter. Name has to be alive till the read back.
+  // -1 if all scopes of frame are taken, such scope isn't measured.
+  int beginScope(std::string_view name, const CommandBuffer& commandBuffer) noexcept;
+  void endScope(int scope, const CommandBuffer& commandBuffer) noexcept;
+  // return copy of the latest finished frame, otherwise race condition between calling code and read back. Number of
+  // frame results are measured in is written to frame, 0 if there are no results yet.
+  std::map<std::string, glm::dvec2> getTimestamps(uint64_t* frame = nullptr);
   ~Timestamps();
 };
 }  // namespace RenderGraph
\ No newline at end of file
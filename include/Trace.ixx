@@ -0,0 +1,71 @@
+export module Trace;
+import <chrono>;
+import <deque>;
+import <map>;
+import <mutex>;
+import <optional>;
+import <string>;
+import <thread>;
+
+export namespace RenderGraph {
+// keeps CPU and GPU spans of the last frames and writes them as Chrome trace event JSON (chrome://tracing, Perfetto)
+class Trace final {
+ private:
+  struct Span {
+    std::string name;
+    std::string track;
+    // CPU: steady clock, GPU: device timestamps, both in ns
+    int64_t begin;
+    int64_t end;
+    uint64_t frame;
+    bool gpu;
+  };
+  uint64_t _frameNumber;
+  uint64_t _frameLast = 0;
+  std::deque<Span> _spans;
+  // host ns = device ns + offset, measured with VK_EXT_calibrated_timestamps
+  std::optional<int64_t> _calibration;
+  std::map<std::thread::id, int> _threads;
+  mutable std::mutex _mutex;
+
+  void _addSpan(Span span);
+
+ public:
+  // frameNumber: how many of the latest frames are kept
+  explicit Trace(int frameNumber);
+  Trace(const Trace&) = delete;
+  Trace& operator=(const Trace&) = delete;
+  Trace(Trace&&) = delete;
+  Trace& operator=(Trace&&) = delete;
+
+  // span of the calling thread, frame is in-flight timeline value of the frame it belongs to
+  void addSpanCPU(std::string_view name,
+                  std::chrono::steady_clock::time_point begin,
+                  std::chrono::steady_clock::time_point end,
+                  uint64_t frame);
+  // span read back from timestamps, track is the queue it's executed on
+  void addSpanGPU(std::string_view name, std::string_view track, int64_t begin, int64_t end, uint64_t frame);
+  // without calibration GPU spans of frame are aligned to the first submit of the frame
+  void setCalibration(std::optional<int64_t> offset) noexcept;
+  bool isCalibrated() const noexcept;
+  int getSpanNumber() const noexcept;
+  void write(std::string_view path) const;
+};
+
+// measures CPU span from construction to destruction, does nothing if trace is nullptr
+class TraceScope final {
+ private:
+  Trace* _trace;
+  std::string_view _name;
+  uint64_t _frame;
+  std::chrono::steady_clock::time_point _begin;
+
+ public:
+  TraceScope(Trace* trace, std::string_view name, uint64_t frame) noexcept;
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+  TraceScope(TraceScope&&) = delete;
+  TraceScope& operator=(TraceScope&&) = delete;
+  ~TraceScope();
+};
+}  // namespace RenderGraph
\ No newline at end of file
@@ -0,0 +1,42 @@
+export module Workers;
+import <vector>;
+import <thread>;
+import <mutex>;
+import <condition_variable>;
+
+export namespace RenderGraph {
+// work owned by caller and reused between frames, workers only store pointer to it
+class Task {
+ public:
+  virtual void execute() = 0;
+  virtual ~Task() = default;
+};
+
+// fixed threads executing tasks from preallocated ring queue, pushing a task allocates neither queue node nor future
+class Workers final {
+ private:
+  std::vector<std::thread> _threads;
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  std::vector<Task*> _tasks;
+  int _head = 0;
+  int _size = 0;
+  bool _stop = false;
+
+  void _resize(int capacity);
+  void _run();
+
+ public:
+  Workers(int threadsNumber);
+  Workers(const Workers&) = delete;
+  Workers& operator=(const Workers&) = delete;
+  Workers(Workers&&) = delete;
+  Workers& operator=(Workers&&) = delete;
+
+  // queue grows only if more tasks are pending at once than reserved
+  void reserve(int capacity);
+  void push(Task& task);
+  int getThreadsNumber() const noexcept;
+  ~Workers();
+};
+}  // namespace RenderGraph
\ No newline at end of file
@@ -41,4 +41,24 @@ MemoryAllocator::MemoryAllocator(const Device& device, const Instance& instance)
 
 VmaAllocator MemoryAllocator::getAllocator() const noexcept { return _allocator; }
 
-MemoryAllocator::~MemoryAllocator() { vmaDestroyAllocator(_allocator); }
\ No newline at end of file
+MemoryAllocator::~MemoryAllocator() { vmaDestroyAllocator(_allocator); }
+
+MemoryAllocation::MemoryAllocation(const VkMemoryRequirements& memoryRequirements,
+                                   const MemoryAllocator& memoryAllocator)
+    : _memoryAllocator(&memoryAllocator) {
+  // VMA_MEMORY_USAGE_AUTO can't be used without buffer/image create info, so request device local memory explicitly
+  VmaAllocationCreateInfo allocCreateInfo{.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+  auto result = vmaAllocateMemory(_memoryAllocator->getAllocator(), &memoryRequirements, &allocCreateInfo,
+                                  &_allocation, nullptr);
+  if (result != VK_SUCCESS) throw std::runtime_error("Can't vmaAllocateMemory");
+}
+
+VmaAllocation MemoryAllocation::getAllocation() const noexcept { return _allocation; }
+
+VkDeviceSize MemoryAllocation::getSize() const noexcept {
+  VmaAllocationInfo allocationInfo;
+  vmaGetAllocationInfo(_memoryAllocator->getAllocator(), _allocation, &allocationInfo);
+  return allocationInfo.size;
+}
+
+MemoryAllocation::~MemoryAllocation() { vmaFreeMemory(_memoryAllocator->getAllocator(), _allocation); }
\ No newline at end of file
@@ -11,10 +11,12 @@ Buffer::Buffer(VkDeviceSize size,
                const MemoryAllocator& memoryAllocator)
     : _memoryAllocator(&memoryAllocator) {
   _size = size;
+  _usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  _flags = flags;
 
   VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
                                 .size = size,
-                                .usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                .usage = _usage,
                                 .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
   VmaAllocationCreateInfo allocCreateInfo = {.flags = flags, .usage = VMA_MEMORY_USAGE_AUTO};
 
@@ -50,11 +52,8 @@ Buffer::Buffer(VkDeviceSize size,
  * and perform explicit transfers.
  */
 void Buffer::setData(std::span<const std::byte> data, const CommandBuffer& commandBufferTransfer) {
-  VkMemoryPropertyFlags memPropFlags;
-  vmaGetAllocationMemoryProperties(_memoryAllocator->getAllocator(), _allocation, &memPropFlags);
-
   // The Allocation ended up in a mappable memory.
-  if (memPropFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+  if (isHostVisible()) {
     // Calling vmaCopyMemoryToAllocation() does vmaMapMemory(), memcpy(), vmaUnmapMemory(), and vmaFlushAllocation().
     auto result = vmaCopyMemoryToAllocation(_memoryAllocator->getAllocator(), data.data(), _allocation, 0, data.size());
     if (result != VK_SUCCESS) throw std::runtime_error("Can't vmaCopyMemoryToAllocation " + result);
@@ -113,6 +112,45 @@ void Buffer::setData(std::span<const std::byte> data, const CommandBuffer& comma
   }
 }
 
+void Buffer::createAliasingBuffer(std::shared_ptr<MemoryAllocation> memoryAllocation) {
+  vmaDestroyBuffer(_memoryAllocator->getAllocator(), _buffer, _allocation);
+  _allocation = nullptr;
+  _allocationInfo = {};
+
+  VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                .size = _size,
+                                .usage = _usage,
+                                .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+  auto result = vmaCreateAliasingBuffer(_memoryAllocator->getAllocator(), memoryAllocation->getAllocation(),
+                                        &bufferInfo, &_buffer);
+  if (result != VK_SUCCESS) throw std::runtime_error("Can't vmaCreateAliasingBuffer");
+  _memoryAliasing = memoryAllocation;
+}
+
+void Buffer::createOwnBuffer() {
+  vmaDestroyBuffer(_memoryAllocator->getAllocator(), _buffer, _allocation);
+  _memoryAliasing = nullptr;
+
+  VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                .size = _size,
+                                .usage = _usage,
+                                .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+  VmaAllocationCreateInfo allocCreateInfo = {.flags = _flags, .usage = VMA_MEMORY_USAGE_AUTO};
+  auto result = vmaCreateBuffer(_memoryAllocator->getAllocator(), &bufferInfo, &allocCreateInfo, &_buffer, &_allocation,
+                                &_allocationInfo);
+  if (result != VK_SUCCESS) throw std::runtime_error("Can't vmaCreateBuffer " + result);
+}
+
+bool Buffer::isAliased() const noexcept { return _memoryAliasing != nullptr; }
+
+bool Buffer::isHostVisible() const noexcept {
+  // aliased buffer has no own allocation
+  if (_allocation == nullptr) return false;
+  VkMemoryPropertyFlags memPropFlags;
+  vmaGetAllocationMemoryProperties(_memoryAllocator->getAllocator(), _allocation, &memPropFlags);
+  return memPropFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
 VkDeviceSize Buffer::getSize() const noexcept { return _size; }
 
 const VmaAllocationInfo& Buffer::getAllocationInfo() const noexcept { return _allocationInfo; }
@@ -124,6 +162,14 @@ VkDeviceAddress Buffer::getDeviceAddress(const Device& device) const noexcept {
   return vkGetBufferDeviceAddress(device.getLogicalDevice(), &addrInfo);
 }
 
+VkMemoryRequirements Buffer::getMemoryRequirements(const Device& device) const noexcept {
+  VkMemoryRequirements memoryRequirements;
+  vkGetBufferMemoryRequirements(device.getLogicalDevice(), _buffer, &memoryRequirements);
+  return memoryRequirements;
+}
+
+const MemoryAllocator& Buffer::getMemoryAllocator() const noexcept { return *_memoryAllocator; }
+
 VkBuffer Buffer::getBuffer() const noexcept { return _buffer; }
 
 Buffer::~Buffer() { vmaDestroyBuffer(_memoryAllocator->getAllocator(), _buffer, _allocation); }
\ No newline at end of file
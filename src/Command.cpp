@@ -1,10 +1,12 @@
 module Command;
 using namespace RenderGraph;
 
-CommandBuffer::CommandBuffer(const CommandPool& pool, const Device& device) : _pool(&pool), _device(&device) {
+CommandBuffer::CommandBuffer(const CommandPool& pool, const Device& device, VkCommandBufferLevel level)
+    : _pool(&pool),
+      _device(&device) {
   VkCommandBufferAllocateInfo allocInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
                                         .commandPool = pool.getCommandPool(),
-                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        .level = level,
                                         .commandBufferCount = 1};
 
   if (vkAllocateCommandBuffers(device.getLogicalDevice(), &allocInfo, &_buffer) != VK_SUCCESS) {
@@ -23,9 +25,22 @@ CommandBuffer::CommandBuffer(CommandBuffer&& commandBuffer) noexcept
     commandBuffer._active = false;
 }
 
-void CommandBuffer::beginCommands() noexcept {
+void CommandBuffer::beginCommands() noexcept { beginCommands(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT); }
+
+void CommandBuffer::beginCommands(VkCommandBufferUsageFlags flags) noexcept {
+  VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, .flags = flags};
+
+  vkBeginCommandBuffer(_buffer, &beginInfo);
+  _active = true;
+}
+
+void CommandBuffer::beginCommands(const VkCommandBufferInheritanceInfo& inheritanceInfo) noexcept {
+  // inherited rendering info means buffer is executed entirely inside rendering
+  VkCommandBufferUsageFlags flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (inheritanceInfo.pNext) flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
   VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-                                     .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+                                     .flags = flags,
+                                     .pInheritanceInfo = &inheritanceInfo};
 
   vkBeginCommandBuffer(_buffer, &beginInfo);
   _active = true;
@@ -1,7 +1,17 @@
 module Device;
+import <limits>;
+import <algorithm>;
+import <cstring>;
+import <filesystem>;
+import <fstream>;
+import <iterator>;
 using namespace RenderGraph;
 
-Device::Device(const Surface& surface, const Instance& instance) {
+Device::Device(const Surface& surface, const Instance& instance) : Device(instance, &surface) {}
+
+Device::Device(const Instance& instance) : Device(instance, nullptr) {}
+
+Device::Device(const Instance& instance, const Surface* surface) {
   VkPhysicalDeviceFeatures deviceFeatures{
       .geometryShader = true,
       .tessellationShader = true,
@@ -26,18 +36,31 @@ Device::Device(const Surface& surface, const Instance& instance) {
   VkPhysicalDeviceBufferDeviceAddressFeatures bufferDeviceAddressFeatures{
       .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES,
       .bufferDeviceAddress = true};
+  // for vkCmdPipelineBarrier2 and vkQueueSubmit2
+  VkPhysicalDeviceSynchronization2Features synchronization2Features{
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+      .synchronization2 = true};
 
   vkb::PhysicalDeviceSelector deviceSelector(instance.getInstance());
   deviceSelector.set_required_features(deviceFeatures);
-  deviceSelector.allow_any_gpu_device_type(false);
+  deviceSelector.allow_any_gpu_device_type(surface == nullptr);
   // not part of Vulkan 1.3 core
   deviceSelector.add_required_extension("VK_EXT_descriptor_buffer");
-  // VK_KHR_SWAPCHAIN_EXTENSION_NAME is added by default
-  auto deviceSelectorResult = deviceSelector.set_surface(surface.getSurface()).select();
+  // optional, aligns GPU timestamps with CPU clock for traces
+  deviceSelector.add_desired_extension("VK_EXT_calibrated_timestamps");
+  // VK_KHR_SWAPCHAIN_EXTENSION_NAME is added by default if present is required
+  if (surface) {
+    deviceSelector.set_surface(surface->getSurface());
+  } else {
+    deviceSelector.require_present(false);
+  }
+  auto deviceSelectorResult = deviceSelector.select();
   if (!deviceSelectorResult) {
     throw std::runtime_error(deviceSelectorResult.error().message());
   }
   auto devicePhysical = deviceSelectorResult.value();
+  // optional, per pass pipeline statistics
+  _pipelineStatistics = devicePhysical.enable_features_if_present({.pipelineStatisticsQuery = true});
 
   vkb::DeviceBuilder builder{devicePhysical};
   builder.add_pNext(&descriptorBufferFeatures);
@@ -45,6 +68,7 @@ Device::Device(const Surface& surface, const Instance& instance) {
   builder.add_pNext(&timelineFeatures);
   builder.add_pNext(&resetFeatures);
   builder.add_pNext(&bufferDeviceAddressFeatures);
+  builder.add_pNext(&synchronization2Features);
   auto builderResult = builder.build();
   if (!builderResult) {
     throw std::runtime_error(builderResult.error().message());
@@ -64,6 +88,18 @@ Device::Device(const Surface& surface, const Instance& instance) {
   vkGetPhysicalDeviceQueueFamilyProperties(getPhysicalDevice(), &queueFamilyCount, nullptr);
   _queueFamilyProperties.resize(queueFamilyCount);
   vkGetPhysicalDeviceQueueFamilyProperties(getPhysicalDevice(), &queueFamilyCount, _queueFamilyProperties.data());
+
+  if (devicePhysical.is_extension_present("VK_EXT_calibrated_timestamps")) {
+    uint32_t timeDomainCount = 0;
+    vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(getPhysicalDevice(), &timeDomainCount, nullptr);
+    _timeDomains.resize(timeDomainCount);
+    vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(getPhysicalDevice(), &timeDomainCount, _timeDomains.data());
+    _calibratedTimestamps = std::ranges::contains(_timeDomains, VK_TIME_DOMAIN_DEVICE_EXT);
+  }
+
+  VkPipelineCacheCreateInfo pipelineCacheInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+  if (vkCreatePipelineCache(_device.device, &pipelineCacheInfo, nullptr, &_pipelineCache) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create pipeline cache");
 }
 
 const VkQueueFamilyProperties& Device::getQueueFamilyProperties(vkb::QueueType type) const noexcept {
@@ -72,6 +108,60 @@ const VkQueueFamilyProperties& Device::getQueueFamilyProperties(vkb::QueueType t
 
 const VkPhysicalDeviceProperties& Device::getDeviceProperties() const noexcept { return _deviceProperties; }
 
+bool Device::isCalibratedTimestamps() const noexcept { return _calibratedTimestamps; }
+
+const std::vector<VkTimeDomainEXT>& Device::getTimeDomains() const noexcept { return _timeDomains; }
+
+bool Device::isPipelineStatistics() const noexcept { return _pipelineStatistics; }
+
+VkPipelineCache Device::getPipelineCache() const noexcept { return _pipelineCache; }
+
+bool Device::loadPipelineCache(std::string_view path) {
+  std::ifstream file(std::string(path), std::ios::binary);
+  if (file.is_open() == false) return false;
+  std::vector<char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+  // not every driver validates initial data, cache of another GPU or driver version can crash it
+  VkPipelineCacheHeaderVersionOne header;
+  if (data.size() < sizeof(header)) return false;
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (header.headerSize < sizeof(header) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+      header.vendorID != _deviceProperties.vendorID || header.deviceID != _deviceProperties.deviceID ||
+      std::ranges::equal(header.pipelineCacheUUID, _deviceProperties.pipelineCacheUUID) == false)
+    return false;
+
+  VkPipelineCacheCreateInfo pipelineCacheInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+                                              .initialDataSize = data.size(),
+                                              .pInitialData = data.data()};
+  VkPipelineCache pipelineCache;
+  if (vkCreatePipelineCache(_device.device, &pipelineCacheInfo, nullptr, &pipelineCache) != VK_SUCCESS) return false;
+  // pipelines compiled before load stay in the cache, loaded ones are added to them
+  auto result = vkMergePipelineCaches(_device.device, _pipelineCache, 1, &pipelineCache);
+  vkDestroyPipelineCache(_device.device, pipelineCache, nullptr);
+  return result == VK_SUCCESS;
+}
+
+void Device::savePipelineCache(std::string_view path) const {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(_device.device, _pipelineCache, &size, nullptr) != VK_SUCCESS)
+    throw std::runtime_error("Failed to get pipeline cache data");
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(_device.device, _pipelineCache, &size, data.data()) != VK_SUCCESS)
+    throw std::runtime_error("Failed to get pipeline cache data");
+
+  auto pathTemporary = std::string(path) + ".tmp";
+  std::ofstream file(pathTemporary, std::ios::binary | std::ios::trunc);
+  if (file.is_open() == false) throw std::runtime_error("Failed to open pipeline cache file");
+  file.write(data.data(), size);
+  file.close();
+  std::error_code error;
+  if (file.fail() == false) std::filesystem::rename(pathTemporary, std::string(path), error);
+  if (file.fail() || error) {
+    std::filesystem::remove(pathTemporary, error);
+    throw std::runtime_error("Failed to write pipeline cache file");
+  }
+}
+
 const VkPhysicalDeviceDescriptorBufferPropertiesEXT& Device::getDescriptorBufferProperties() const noexcept {
   return _descriptorBufferProperties;
 }
@@ -123,4 +213,34 @@ int Device::getQueueIndex(vkb::QueueType type) const {
   return queueResult.value();
 }
 
-Device::~Device() { vkb::destroy_device(_device); }
\ No newline at end of file
+void Device::destroyDeferred(std::shared_ptr<void> resource, uint64_t value) const {
+  std::unique_lock<std::mutex> lock(_mutexDestroy);
+  // destroying later than asked is safe, so queue stays sorted and is processed from the front only
+  if (_destroyQueue.empty() == false) value = std::max(value, _destroyQueue.back().first);
+  _destroyQueue.emplace_back(value, std::move(resource));
+}
+
+void Device::destroyCompleted(uint64_t value) const {
+  std::vector<std::shared_ptr<void>> completed;
+  {
+    std::unique_lock<std::mutex> lock(_mutexDestroy);
+    while (_destroyQueue.empty() == false && _destroyQueue.front().first <= value) {
+      completed.push_back(std::move(_destroyQueue.front().second));
+      _destroyQueue.pop_front();
+    }
+  }
+  // resources are destroyed outside of the lock, so their destructors can defer something else
+  completed.clear();
+}
+
+int Device::getDestroyQueueSize() const {
+  std::unique_lock<std::mutex> lock(_mutexDestroy);
+  return _destroyQueue.size();
+}
+
+Device::~Device() {
+  // device is destroyed after GPU is idle, nothing can be in use anymore
+  destroyCompleted(std::numeric_limits<uint64_t>::max());
+  vkDestroyPipelineCache(_device.device, _pipelineCache, nullptr);
+  vkb::destroy_device(_device);
+}
\ No newline at end of file
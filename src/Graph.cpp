@@ -1,74 +1,422 @@
 module Graph;
 import <set>;
 import <ranges>;
+import <algorithm>;
+import <unordered_map>;
+import <thread>;
 using namespace RenderGraph;
 
-void GraphStorage::add(std::string_view name, std::unique_ptr<ImageViewHolder> imageHolder) noexcept {
-  _imageViewHolders[std::string(name)] = std::move(imageHolder);
+ImageHandle GraphStorage::add(std::string_view name, std::unique_ptr<ImageViewHolder> imageHolder) noexcept {
+  auto handle = getImageHandle(name);
+  if (handle.index < 0) {
+    handle.index = _imageViewHolders.size();
+    _imageViewHolders.emplace_back();
+    _imageNames.emplace_back(name);
+    _imageHandles.emplace(name, handle);
+  }
+  _imageViewHolders[handle.index] = std::move(imageHolder);
+  return handle;
+}
+
+BufferHandle GraphStorage::add(std::string_view name, std::vector<std::unique_ptr<Buffer>>& buffers) noexcept {
+  auto handle = getBufferHandle(name);
+  if (handle.index < 0) {
+    handle.index = _buffers.size();
+    _buffers.emplace_back();
+    _bufferNames.emplace_back(name);
+    _bufferHandles.emplace(name, handle);
+  }
+  _buffers[handle.index] = std::move(buffers);
+  return handle;
+}
+
+ImageHandle GraphStorage::getImageHandle(std::string_view name) const noexcept {
+  auto it = _imageHandles.find(name);
+  if (it == _imageHandles.end()) return ImageHandle{};
+  return it->second;
 }
 
-void GraphStorage::add(std::string_view name, std::vector<std::unique_ptr<Buffer>>& buffers) noexcept {
-  _buffers[std::string(name)] = std::move(buffers);
+BufferHandle GraphStorage::getBufferHandle(std::string_view name) const noexcept {
+  auto it = _bufferHandles.find(name);
+  if (it == _bufferHandles.end()) return BufferHandle{};
+  return it->second;
+}
+
+const std::string& GraphStorage::getName(ImageHandle handle) const noexcept { return _imageNames[handle.index]; }
+
+const std::string& GraphStorage::getName(BufferHandle handle) const noexcept { return _bufferNames[handle.index]; }
+
+void GraphStorage::setTransient(std::string_view name) noexcept { _transient.insert(std::string(name)); }
+
+void GraphStorage::setExported(std::string_view name) noexcept { _exported.insert(std::string(name)); }
+
+const std::set<std::string>& GraphStorage::getExported() const noexcept { return _exported; }
+
+const std::set<std::string>& GraphStorage::getTransient() const noexcept { return _transient; }
+
+AliasingStatistics GraphStorage::alias(const std::map<std::string, glm::ivec2>& lifetimes,
+                                       const Device& device,
+                                       bool recreateBuffers) {
+  struct Resource {
+    std::string name;
+    glm::ivec2 lifetime;
+    VkMemoryRequirements memoryRequirements;
+  };
+  struct Slot {
+    std::vector<Resource> resources;
+    VkMemoryRequirements memoryRequirements;
+  };
+  auto mergeRequirements = [](VkMemoryRequirements& target, const VkMemoryRequirements& source) {
+    target.size = std::max(target.size, source.size);
+    target.alignment = std::max(target.alignment, source.alignment);
+    target.memoryTypeBits &= source.memoryTypeBits;
+  };
+
+  AliasingStatistics statistics;
+  _aliasedImages.clear();
+  _aliasedBuffers.clear();
+  // images and buffers are never mixed so bufferImageGranularity doesn't matter. Resource shares memory only with
+  // resources that have the same number of copies: i-th copy (usually frame in flight) shares memory with i-th copy.
+  std::map<std::pair<bool, int>, std::vector<Resource>> groups;
+  for (auto&& name : _transient) {
+    // exported content is consumed outside of the graph so it has to survive
+    if (lifetimes.contains(name) == false || _exported.contains(name)) continue;
+
+    Resource resource{.name = name,
+                      .lifetime = lifetimes.at(name),
+                      .memoryRequirements = {.size = 0, .alignment = 1, .memoryTypeBits = ~0u}};
+    bool isImage = _imageHandles.contains(name);
+    int copies = 0;
+    if (isImage) {
+      for (auto&& imageView : getImageViewHolder(name).getImageViews()) {
+        mergeRequirements(resource.memoryRequirements, imageView->getImage().getMemoryRequirements(device));
+        copies++;
+      }
+    } else if (_bufferHandles.contains(name)) {
+      // CPU writes to host visible buffer through its mapping, shared memory is device local only
+      if (std::ranges::any_of(_buffers[getBufferHandle(name).index],
+                              [](const std::unique_ptr<Buffer>& buffer) { return buffer->isHostVisible(); }))
+        continue;
+      for (auto&& buffer : _buffers[getBufferHandle(name).index]) {
+        mergeRequirements(resource.memoryRequirements, buffer->getMemoryRequirements(device));
+        copies++;
+      }
+    }
+    if (copies == 0) continue;
+
+    statistics.naiveSize += resource.memoryRequirements.size * copies;
+    groups[{isImage, copies}].push_back(resource);
+  }
+
+  for (auto&& [key, resources] : groups) {
+    auto [isImage, copies] = key;
+    // greedy: the biggest resources are placed first, every resource goes to the first slot it doesn't intersect with
+    std::ranges::sort(resources, std::greater{},
+                      [](const Resource& resource) { return resource.memoryRequirements.size; });
+    std::vector<Slot> slots;
+    for (auto&& resource : resources) {
+      auto intersect = [&resource](const Resource& other) {
+        return resource.lifetime.x <= other.lifetime.y && other.lifetime.x <= resource.lifetime.y;
+      };
+      auto slot = std::ranges::find_if(slots, [&](const Slot& slot) {
+        return (slot.memoryRequirements.memoryTypeBits & resource.memoryRequirements.memoryTypeBits) != 0 &&
+               std::ranges::none_of(slot.resources, intersect);
+      });
+      if (slot == slots.end()) {
+        slots.push_back(Slot{.memoryRequirements = resource.memoryRequirements});
+        slot = std::prev(slots.end());
+      } else {
+        mergeRequirements(slot->memoryRequirements, resource.memoryRequirements);
+      }
+      slot->resources.push_back(resource);
+    }
+
+    for (auto&& slot : slots) {
+      statistics.peakSize += slot.memoryRequirements.size * copies;
+      // nothing to share memory with, keep own allocation
+      if (slot.resources.size() < 2) continue;
+      if (isImage == false && recreateBuffers == false) {
+        for (auto&& resource : slot.resources) _aliasedBuffers.insert(resource.name);
+        continue;
+      }
+
+      for (int i = 0; i < copies; i++) {
+        std::shared_ptr<MemoryAllocation> memoryAllocation;
+        for (auto&& resource : slot.resources) {
+          if (isImage) {
+            auto imageView = getImageViewHolder(resource.name).getImageViews()[i];
+            auto& image = imageView->getImage();
+            if (memoryAllocation == nullptr)
+              memoryAllocation = std::make_shared<MemoryAllocation>(slot.memoryRequirements,
+                                                                    image.getMemoryAllocator());
+            image.createAliasingImage(memoryAllocation);
+            imageView->destroy();
+            imageView->createImageView(imageView->getType(), imageView->getBaseMipMap(),
+                                       imageView->getBaseArrayLayer());
+            _aliasedImages.insert(resource.name);
+          } else {
+            auto& buffer = _buffers[getBufferHandle(resource.name).index][i];
+            if (memoryAllocation == nullptr)
+              memoryAllocation = std::make_shared<MemoryAllocation>(slot.memoryRequirements,
+                                                                    buffer->getMemoryAllocator());
+            buffer->createAliasingBuffer(memoryAllocation);
+            _aliasedBuffers.insert(resource.name);
+          }
+        }
+      }
+    }
+  }
+
+  // resource that left its group would stay in shared memory with resources it overlaps with now
+  _restored.clear();
+  for (int index = 0; index < _imageViewHolders.size(); index++) {
+    if (_aliasedImages.contains(_imageNames[index])) continue;
+    for (auto&& imageView : _imageViewHolders[index]->getImageViews()) {
+      if (imageView->getImage().isAliased() == false) continue;
+      imageView->getImage().createOwnImage();
+      imageView->destroy();
+      imageView->createImageView(imageView->getType(), imageView->getBaseMipMap(), imageView->getBaseArrayLayer());
+      _restored.insert(_imageNames[index]);
+    }
+  }
+  for (int index = 0; index < _buffers.size() && recreateBuffers; index++) {
+    if (_aliasedBuffers.contains(_bufferNames[index])) continue;
+    for (auto&& buffer : _buffers[index]) {
+      if (buffer->isAliased() == false) continue;
+      buffer->createOwnBuffer();
+      _restored.insert(_bufferNames[index]);
+    }
+  }
+
+  return statistics;
 }
 
-void GraphStorage::reset(std::vector<std::shared_ptr<ImageView>> oldSwapchain,
-                         std::vector<std::shared_ptr<ImageView>> newSwapchain,
-                         const CommandBuffer& commandBuffer) noexcept {
+const std::set<std::string>& GraphStorage::getAliasedImages() const noexcept { return _aliasedImages; }
+
+const std::set<std::string>& GraphStorage::getAliasedBuffers() const noexcept { return _aliasedBuffers; }
+
+const std::set<std::string>& GraphStorage::getRestored() const noexcept { return _restored; }
+
+std::vector<std::shared_ptr<ImageView>> GraphStorage::reset(std::vector<std::shared_ptr<ImageView>> oldSwapchain,
+                                                            std::vector<std::shared_ptr<ImageView>> newSwapchain,
+                                                            const CommandBuffer& commandBuffer) noexcept {
+  std::vector<std::shared_ptr<ImageView>> retired;
   glm::ivec2 resolution = newSwapchain.front()->getImage().getResolution();
-  auto nameSwapchain = find(oldSwapchain);
-  if (nameSwapchain.empty() == false) {
-    _imageViewHolders[nameSwapchain]->setImageViews(newSwapchain);
+  auto handleSwapchain = getImageHandle(find(oldSwapchain));
+  if (handleSwapchain.index >= 0) {
+    _imageViewHolders[handleSwapchain.index]->setImageViews(newSwapchain);
   }
 
-  for (auto&& [name, value] : _imageViewHolders) {
-    if (name != nameSwapchain) {
-      auto indexFunction = value->getIndexFunction();
+  for (int index = 0; index < _imageViewHolders.size(); index++) {
+    auto& value = _imageViewHolders[index];
+    if (index != handleSwapchain.index) {
+      // transient images are aliased again, so they are recreated even if resolution is the same
+      bool transient = _transient.contains(_imageNames[index]);
       auto imageViews = value->getImageViews();
       for (int i = 0; i < imageViews.size(); i++) {
         auto& image = imageViews[i]->getImage();
-        if (image.getResolution() != resolution) {
-          // recreate image
-          image.destroy();
-          image.createImage(image.getFormat(), resolution, image.getMipMapNumber(), image.getLayerNumber(),
-                            image.getAspectMask(), image.getUsageFlags());
-          image.changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
-                             commandBuffer);
-          imageViews[i]->destroy();
-          imageViews[i]->createImageView(imageViews[i]->getType(), imageViews[i]->getBaseMipMap(),
-                                         imageViews[i]->getBaseArrayLayer());
-        }
+        if (image.getResolution() == resolution && transient == false) continue;
+
+        // frames in flight can still use the old image, so the new one is created next to it
+        auto imageNew = std::make_unique<Image>(image.getMemoryAllocator());
+        imageNew->createImage(image.getFormat(), resolution, image.getMipMapNumber(), image.getLayerNumber(),
+                              image.getAspectMask(), image.getUsageFlags());
+        // layout of transient image is set after aliasing
+        if (transient == false)
+          imageNew->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                                 commandBuffer);
+        auto imageViewNew = std::make_shared<ImageView>(std::move(imageNew), imageViews[i]->getDevice());
+        imageViewNew->createImageView(imageViews[i]->getType(), imageViews[i]->getBaseMipMap(),
+                                      imageViews[i]->getBaseArrayLayer());
+        retired.push_back(value->setImageView(i, imageViewNew));
       }
     }
   }
+  return retired;
 }
 
 std::string GraphStorage::find(const std::vector<std::shared_ptr<ImageView>>& imageViews) noexcept {
-  for (auto&& [name, imageViewHolder] : _imageViewHolders) {
-    if (imageViewHolder->contains(imageViews)) return name;
+  for (auto&& [name, handle] : _imageHandles) {
+    if (_imageViewHolders[handle.index]->contains(imageViews)) return name;
   }
   return std::string{};
 }
 
-const ImageViewHolder& GraphStorage::getImageViewHolder(std::string_view name) const noexcept {
-  return *_imageViewHolders.at(std::string(name));
+const ImageViewHolder& GraphStorage::getImageViewHolder(ImageHandle handle) const noexcept {
+  return *_imageViewHolders[handle.index];
 }
 
-std::vector<Buffer*> GraphStorage::getBuffer(std::string_view name) const noexcept {
+const ImageViewHolder& GraphStorage::getImageViewHolder(std::string_view name) const {
+  auto it = _imageHandles.find(name);
+  if (it == _imageHandles.end()) throw std::runtime_error("Graph storage has no image " + std::string(name));
+  return getImageViewHolder(it->second);
+}
+
+std::vector<Buffer*> GraphStorage::getBuffer(BufferHandle handle) const noexcept {
   // std::ranges::to makes vector by itself
-  return _buffers.at(std::string(name)) | std::views::transform([](auto& p) { return p.get(); }) |
+  return _buffers[handle.index] | std::views::transform([](auto& p) { return p.get(); }) |
          std::ranges::to<std::vector>();
 }
 
-GraphPass::GraphPass(std::string_view name, GraphPassType graphPassType, const GraphStorage& graphStorage) noexcept
+std::vector<Buffer*> GraphStorage::getBuffer(std::string_view name) const {
+  auto it = _bufferHandles.find(name);
+  if (it == _bufferHandles.end()) throw std::runtime_error("Graph storage has no buffer " + std::string(name));
+  return getBuffer(it->second);
+}
+
+void GraphElement::markDirty() noexcept { _version++; }
+
+uint64_t GraphElement::getVersion() const noexcept { return _version; }
+
+bool GraphElement::isRenderingScopeSeparate() const noexcept { return false; }
+
+GraphPass::GraphPass(std::string_view name,
+                     GraphPassType graphPassType,
+                     const GraphStorage& graphStorage,
+                     const Device& device) noexcept
     : _name(name),
       _graphPassType(graphPassType),
-      _graphStorage(&graphStorage) {}
+      _graphStorage(&graphStorage),
+      _device(&device) {}
 
 void GraphPass::registerGraphElement(std::shared_ptr<GraphElement> graphElement) noexcept {
   _graphElements.push_back(graphElement);
+  // new element has its own version from 0, so it wouldn't change sum of versions
+  markDirty();
+}
+
+const std::string& GraphPass::getName() const noexcept { return _name; }
+
+void GraphPass::setParallelRecording(int threadsNumber) {
+  _commandBuffersUpdate.clear();
+  _commandBuffersDraw.clear();
+  _commandPoolsChunk.clear();
+  _chunkTasks.clear();
+  _commandBuffersExecute.clear();
+  _workersChunks.reset();
+  if (threadsNumber <= 0) return;
+
+  _workersChunks = std::make_unique<Workers>(threadsNumber);
+  _chunkTasks.resize(threadsNumber);
+  _commandBuffersExecute.resize(threadsNumber);
+  auto createCommandBuffers = [this]() {
+    std::vector<std::unique_ptr<CommandBuffer>> commandBuffers(_commandBuffers.size());
+    std::ranges::generate(commandBuffers, [this] {
+      return std::make_unique<CommandBuffer>(*_commandPoolsChunk.back(), *_device, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    });
+    return commandBuffers;
+  };
+  for (int i = 0; i < threadsNumber; i++) {
+    // command pool can't be used from several threads at once
+    _commandPoolsChunk.push_back(std::make_unique<CommandPool>(_commandPool->getType(), *_device));
+    _commandBuffersUpdate.push_back(createCommandBuffers());
+    _commandBuffersDraw.push_back(createCommandBuffers());
+    _chunkTasks[i].pass = this;
+    _chunkTasks[i].chunk = i;
+  }
+}
+
+bool GraphPass::isParallelRecording() const noexcept { return _workersChunks != nullptr; }
+
+void GraphPass::setStatic(bool value) noexcept { _static = value; }
+
+bool GraphPass::isStatic() const noexcept { return _static; }
+
+void GraphPass::setElementTimestamps(bool value) noexcept { _elementTimestamps = value; }
+
+bool GraphPass::isElementTimestamps() const noexcept { return _elementTimestamps; }
+
+int GraphPass::compileTimestamps() {
+  _elementNames.clear();
+  // static pass isn't measured
+  if (_elementTimestamps == false || _static) return 0;
+  for (int i = 0; i < _graphElements.size(); i++) _elementNames.push_back(_name + "/" + std::to_string(i));
+  return _elementNames.size();
+}
+
+void GraphPass::markDirty() noexcept { _version++; }
+
+uint64_t GraphPass::getVersion() const noexcept {
+  // versions only grow, so sum changes if any of them changes. Own version of pass changes if element is registered.
+  uint64_t version = _version;
+  for (auto&& graphElement : _graphElements) version += graphElement->getVersion();
+  return version;
+}
+
+std::vector<std::unique_ptr<CommandBuffer>> GraphPass::allocateCommandBuffersStatic(int number) {
+  if (_static == false) number = 0;
+  _versionsStatic.assign(number, std::nullopt);
+  if (_commandBuffersStatic.size() == number) return {};
+
+  auto commandBuffersOld = std::move(_commandBuffersStatic);
+  _commandBuffersStatic.clear();
+  _commandBuffersStatic.resize(number);
+  std::ranges::generate(_commandBuffersStatic,
+                        [this] { return std::make_unique<CommandBuffer>(*_commandPool, *_device); });
+  return commandBuffersOld;
+}
+
+CommandBuffer* GraphPass::getCommandBufferStatic(int index) const noexcept {
+  if (_static == false || index >= _commandBuffersStatic.size()) return nullptr;
+  return _commandBuffersStatic[index].get();
+}
+
+bool GraphPass::isRecorded(int index) const noexcept { return _versionsStatic[index] == getVersion(); }
+
+void GraphPass::setRecorded(int index) noexcept { _versionsStatic[index] = getVersion(); }
+
+void GraphPass::_drawElement(int index,
+                             int currentFrame,
+                             const CommandBuffer& commandBuffer,
+                             Timestamps* timestamps) {
+  if (timestamps == nullptr || _elementNames.empty()) {
+    _graphElements[index]->draw(currentFrame, commandBuffer);
+    return;
+  }
+  int scope = timestamps->beginScope(_elementNames[index], commandBuffer);
+  _graphElements[index]->draw(currentFrame, commandBuffer);
+  timestamps->endScope(scope, commandBuffer);
+}
+
+void GraphPass::ChunkTask::execute() {
+  VkCommandBufferInheritanceInfo inheritanceUpdate{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+  auto& commandBufferUpdate = *pass->_commandBuffersUpdate[chunk][currentFrame];
+  auto& commandBufferDraw = *pass->_commandBuffersDraw[chunk][currentFrame];
+  int chunks = pass->_chunkTasks.size();
+  int elements = pass->_graphElements.size();
+  if (update) commandBufferUpdate.beginCommands(inheritanceUpdate);
+  commandBufferDraw.beginCommands(*inheritanceDraw);
+  for (int i = chunk * elements / chunks; i < (chunk + 1) * elements / chunks; i++) {
+    if (update) pass->_graphElements[i]->update(currentFrame, commandBufferUpdate);
+    pass->_drawElement(i, currentFrame, commandBufferDraw, timestamps);
+  }
+  if (update) commandBufferUpdate.endCommands();
+  commandBufferDraw.endCommands();
+  if (--pass->_chunksRemaining == 0) pass->_chunksRemaining.notify_all();
+}
+
+void GraphPass::_recordChunks(int currentFrame,
+                              bool update,
+                              const VkCommandBufferInheritanceInfo& inheritanceDraw,
+                              Timestamps* timestamps) {
+  _chunksRemaining = _chunkTasks.size();
+  for (auto&& task : _chunkTasks) {
+    task.currentFrame = currentFrame;
+    task.update = update;
+    task.inheritanceDraw = &inheritanceDraw;
+    task.timestamps = timestamps;
+    _workersChunks->push(task);
+  }
+  for (int remaining = _chunksRemaining; remaining != 0; remaining = _chunksRemaining)
+    _chunksRemaining.wait(remaining);
 }
 
-std::string GraphPass::getName() const noexcept { return _name; }
+void GraphPass::_executeChunks(int currentFrame, bool update, const CommandBuffer& commandBuffer) {
+  auto& commandBuffers = update ? _commandBuffersUpdate : _commandBuffersDraw;
+  for (int i = 0; i < commandBuffers.size(); i++)
+    _commandBuffersExecute[i] = commandBuffers[i][currentFrame]->getCommandBuffer();
+  vkCmdExecuteCommands(commandBuffer.getCommandBuffer(), _commandBuffersExecute.size(), _commandBuffersExecute.data());
+}
 
 void GraphPass::reset(const std::vector<std::shared_ptr<RenderGraph::ImageView>>& swapchain,
                       CommandBuffer& commandBuffer) {
@@ -83,8 +431,16 @@ void GraphPass::addSignalSemaphore(std::vector<std::shared_ptr<Semaphore>>& sign
 }
 
 void GraphPass::addWaitSemaphore(std::vector<std::shared_ptr<Semaphore>>& waitSemaphore,
-                                 std::function<int()> index) noexcept {
+                                 std::function<int()> index,
+                                 VkPipelineStageFlags2 waitStage) noexcept {
   _waitSemaphores.push_back({waitSemaphore, index});
+  _waitStages.push_back(waitStage);
+}
+
+void GraphPass::clearSemaphores() noexcept {
+  _signalSemaphores.clear();
+  _waitSemaphores.clear();
+  _waitStages.clear();
 }
 
 GraphPassType GraphPass::getGraphPassType() const noexcept { return _graphPassType; }
@@ -106,16 +462,35 @@ std::vector<Semaphore*> GraphPass::getWaitSemaphores() const noexcept {
          std::ranges::to<std::vector>();
 }
 
+int GraphPass::getSignalSemaphoreNumber() const noexcept { return _signalSemaphores.size(); }
+
+Semaphore* GraphPass::getSignalSemaphore(int index) const noexcept {
+  auto& [semaphores, semaphoreIndex] = _signalSemaphores[index];
+  return semaphores[semaphoreIndex()].get();
+}
+
+int GraphPass::getWaitSemaphoreNumber() const noexcept { return _waitSemaphores.size(); }
+
+Semaphore* GraphPass::getWaitSemaphore(int index) const noexcept {
+  auto& [semaphores, semaphoreIndex] = _waitSemaphores[index];
+  return semaphores[semaphoreIndex()].get();
+}
+
+const std::vector<VkPipelineStageFlags2>& GraphPass::getWaitStages() const noexcept { return _waitStages; }
+
 std::vector<CommandBuffer*> GraphPass::getCommandBuffers() const noexcept {
   return _commandBuffers | std::views::transform([](auto& p) { return p.get(); }) | std::ranges::to<std::vector>();
 }
 
+CommandBuffer* GraphPass::getCommandBuffer(int frameInFlight) const noexcept {
+  return _commandBuffers[frameInFlight].get();
+}
+
 GraphPassGraphic::GraphPassGraphic(std::string_view name,
                                    int maxFramesInFlight,
                                    const GraphStorage& graphStorage,
                                    const Device& device) noexcept
-    : GraphPass(name, GraphPassType::GRAPHIC, graphStorage) {
-  _device = &device;
+    : GraphPass(name, GraphPassType::GRAPHIC, graphStorage, device) {
   _commandPool = std::make_unique<CommandPool>(vkb::QueueType::graphics, device);
   _commandBuffers.resize(maxFramesInFlight);
   std::ranges::generate(_commandBuffers, [&] { return std::make_unique<CommandBuffer>(*_commandPool, device); });
@@ -128,7 +503,13 @@ void GraphPassGraphic::setDepthTarget(std::string_view name) noexcept { _depthTa
 
 void GraphPassGraphic::addTextureInput(std::string_view name) noexcept { _textureInputs.emplace_back(name); }
 
-void GraphPassGraphic::clearTarget(std::string_view name) noexcept { _clearTarget[std::string(name)] = true; }
+void GraphPassGraphic::clearTarget(std::string_view name, std::optional<VkClearValue> clearValue) noexcept {
+  _clearTarget[std::string(name)] = clearValue;
+}
+
+bool GraphPassGraphic::isCleared(std::string_view name) const noexcept {
+  return _clearTarget.contains(std::string(name));
+}
 
 const std::vector<std::string>& GraphPassGraphic::getColorTargets() const noexcept { return _colorTargets; }
 
@@ -136,6 +517,38 @@ std::optional<std::string> GraphPassGraphic::getDepthTarget() const noexcept { r
 
 const std::vector<std::string>& GraphPassGraphic::getTextureInputs() const noexcept { return _textureInputs; }
 
+std::vector<std::string> GraphPassGraphic::getInputs() const noexcept { return _textureInputs; }
+
+std::vector<std::string> GraphPassGraphic::getOutputs() const noexcept {
+  auto outputs = _colorTargets;
+  if (_depthTarget) outputs.push_back(_depthTarget.value());
+  return outputs;
+}
+
+std::map<std::string, ResourceAccess> GraphPassGraphic::getResourceAccesses() const noexcept {
+  std::map<std::string, ResourceAccess> accesses;
+  // texture can be sampled from any shader stage (e.g. height map in tessellation)
+  for (auto&& name : _textureInputs) {
+    auto& access = accesses[name];
+    access.stage |= VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+    access.accessRead |= VK_ACCESS_2_SHADER_READ_BIT;
+  }
+  // targets are loaded and blended, so they are read as well
+  for (auto&& name : _colorTargets) {
+    auto& access = accesses[name];
+    access.stage |= VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    access.accessRead |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+    access.accessWrite |= VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+  }
+  if (_depthTarget) {
+    auto& access = accesses[_depthTarget.value()];
+    access.stage |= VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    access.accessRead |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    access.accessWrite |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  }
+  return accesses;
+}
+
 PipelineGraphic& GraphPassGraphic::getPipelineGraphic(const GraphStorage& graphStorage) const noexcept {
   auto colorFormats = _colorTargets | std::views::transform([&](auto& colorTarget) {
                         return graphStorage.getImageViewHolder(colorTarget).getImageView().getImage().getFormat();
@@ -151,60 +564,168 @@ PipelineGraphic& GraphPassGraphic::getPipelineGraphic(const GraphStorage& graphS
   return *_pipelineGraphic;
 }
 
-void GraphPassGraphic::execute(int currentFrame, const CommandBuffer& commandBuffer) {
-  auto createColorAttachment = [this](const auto& colorTarget) {
-    auto& imageViewHolder = _graphStorage->getImageViewHolder(colorTarget);
-    VkRenderingAttachmentInfo info{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-                                   .imageView = imageViewHolder.getImageView().getImageView(),
-                                   .imageLayout = imageViewHolder.getImageView().getImage().getImageLayout(),
-                                   .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
-                                   .storeOp = VK_ATTACHMENT_STORE_OP_STORE};
-    if (_clearTarget.contains(colorTarget) && _clearTarget.at(colorTarget)) {
+void GraphPassGraphic::compile(int maxFramesInFlight,
+                               ImageHandle swapchain,
+                               const std::set<std::string>& discardBefore,
+                               const std::set<std::string>& discardAfter) noexcept {
+  // element with its own rendering scope loads what the previous scope stored, so nothing can be discarded in between
+  bool scopesSplit = std::ranges::any_of(
+      _graphElements, [](auto& graphElement) { return graphElement->isRenderingScopeSeparate(); });
+  auto setOps = [&](VkRenderingAttachmentInfo& info, const std::string& name, VkClearValue clearValue) {
+    if (_clearTarget.contains(name)) {
       info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-      info.clearValue.color = {0.f, 0.f, 0.f, 1.f};
+      info.clearValue = _clearTarget.at(name).value_or(clearValue);
+    } else if (discardBefore.contains(name)) {
+      info.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     }
-    return info;
+    if (discardAfter.contains(name) && scopesSplit == false) info.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   };
+  _colorHandles = _colorTargets | std::views::transform([this](auto& colorTarget) {
+                    return _graphStorage->getImageHandle(colorTarget);
+                  }) |
+                  std::ranges::to<std::vector>();
+  auto& colorHandles = _colorHandles;
+  _depthHandle = std::nullopt;
+  if (_depthTarget.has_value()) _depthHandle = _graphStorage->getImageHandle(_depthTarget.value());
+  auto& depthHandle = _depthHandle;
+
+  // plans differ by swapchain image only if pass renders to swapchain
+  _swapchain = std::nullopt;
+  _swapchainImages = 1;
+  if (swapchain.index >= 0 && std::ranges::contains(colorHandles, swapchain)) {
+    _swapchain = swapchain;
+    _swapchainImages = _graphStorage->getImageViewHolder(swapchain).getImageViews().size();
+  }
 
-  for (auto&& graphElement : _graphElements) {
-    std::vector<VkRenderingAttachmentInfo> colorAttachments = _colorTargets |
-                                                              std::views::transform(createColorAttachment) |
-                                                              std::ranges::to<std::vector>();
-
-    std::optional<VkRenderingAttachmentInfo> depthAttachment = std::nullopt;
-    if (_depthTarget.has_value()) {
-      auto& target = _depthTarget.value();
-      auto& imageViewHolder = _graphStorage->getImageViewHolder(target);
-
-      depthAttachment = VkRenderingAttachmentInfo{
-          .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-          .imageView = imageViewHolder.getImageView().getImageView(),
-          .imageLayout = imageViewHolder.getImageView().getImage().getImageLayout(),
-          .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
-          .storeOp = VK_ATTACHMENT_STORE_OP_STORE};
-      if (_clearTarget.contains(target) && _clearTarget.at(target)) {
-        depthAttachment->loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment->clearValue.depthStencil = {1.f, 0};
+  // every image stays in GENERAL. Swapchain image is i-th copy for i-th swapchain image, other resources start with
+  // i-th copy for i-th frame in flight and are replaced by updateAttachments if their holder picks another one.
+  auto getImageView = [&](ImageHandle handle, int frame, int swapchainIndex) -> ImageView& {
+    auto imageViews = _graphStorage->getImageViewHolder(handle).getImageViews();
+    if (handle == swapchain) return *imageViews[swapchainIndex];
+    return *imageViews[frame % imageViews.size()];
+  };
+  _renderingPlans.clear();
+  _renderingPlans.resize(maxFramesInFlight * _swapchainImages);
+  for (int frame = 0; frame < maxFramesInFlight; frame++) {
+    for (int swapchainIndex = 0; swapchainIndex < _swapchainImages; swapchainIndex++) {
+      auto& plan = _renderingPlans[frame * _swapchainImages + swapchainIndex];
+      for (int i = 0; i < colorHandles.size(); i++) {
+        auto& imageView = getImageView(colorHandles[i], frame, swapchainIndex);
+        VkRenderingAttachmentInfo info{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                       .imageView = imageView.getImageView(),
+                                       .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+                                       .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+                                       .storeOp = VK_ATTACHMENT_STORE_OP_STORE};
+        setOps(info, _colorTargets[i], VkClearValue{.color = {0.f, 0.f, 0.f, 1.f}});
+        plan.colorAttachments.push_back(info);
+        plan.colorFormats.push_back(imageView.getImage().getFormat());
+      }
+
+      if (depthHandle.has_value()) {
+        auto& imageView = getImageView(depthHandle.value(), frame, swapchainIndex);
+        plan.depthAttachment = {.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                .imageView = imageView.getImageView(),
+                                .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+                                .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+                                .storeOp = VK_ATTACHMENT_STORE_OP_STORE};
+        setOps(plan.depthAttachment, _depthTarget.value(), VkClearValue{.depthStencil = {1.f, 0}});
+        plan.depthFormat = imageView.getImage().getFormat();
       }
+
+      // take image resolution, it's safe
+      auto resolution = getImageView(colorHandles.front(), frame, swapchainIndex).getImage().getResolution();
+      // plans aren't moved after this point, so pointers to attachments stay valid
+      plan.renderingInfo = {.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+                            .renderArea = {.offset = {0, 0}, .extent = VkExtent2D(resolution.x, resolution.y)},
+                            .layerCount = 1,
+                            .colorAttachmentCount = static_cast<uint32_t>(plan.colorAttachments.size()),
+                            .pColorAttachments = plan.colorAttachments.data(),
+                            .pDepthAttachment = depthHandle.has_value() ? &plan.depthAttachment : nullptr};
+      // the following scopes of the same pass keep what previous scopes stored
+      plan.colorAttachmentsLoad = plan.colorAttachments;
+      for (auto&& attachment : plan.colorAttachmentsLoad) attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+      plan.depthAttachmentLoad = plan.depthAttachment;
+      plan.depthAttachmentLoad.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+      plan.renderingInfoLoad = plan.renderingInfo;
+      plan.renderingInfoLoad.pColorAttachments = plan.colorAttachmentsLoad.data();
+      if (depthHandle.has_value()) plan.renderingInfoLoad.pDepthAttachment = &plan.depthAttachmentLoad;
     }
+  }
+}
+
+const VkRenderingInfo& GraphPassGraphic::getRenderingInfo(int currentFrame, int swapchainIndex) const noexcept {
+  return _renderingPlans[currentFrame * _swapchainImages + (_swapchain.has_value() ? swapchainIndex : 0)]
+      .renderingInfo;
+}
 
-    VkRenderingInfo renderingInfo = {};
-    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-    renderingInfo.renderArea.offset = {0, 0};
-    // take image resolution, it's safe
-    auto resolution =
-        _graphStorage->getImageViewHolder(_colorTargets.front()).getImageView().getImage().getResolution();
-    renderingInfo.renderArea.extent = VkExtent2D(resolution.x, resolution.y);
-    renderingInfo.layerCount = 1;
-    renderingInfo.colorAttachmentCount = colorAttachments.size();
-    renderingInfo.pColorAttachments = colorAttachments.data();
-    if (depthAttachment.has_value()) renderingInfo.pDepthAttachment = &depthAttachment.value();
+void GraphPassGraphic::updateAttachments(int currentFrame, int swapchainIndex) noexcept {
+  auto& plan = _renderingPlans[currentFrame * _swapchainImages + (_swapchain.has_value() ? swapchainIndex : 0)];
+  bool changed = false;
+  auto update = [&](ImageHandle handle, VkRenderingAttachmentInfo& info, VkRenderingAttachmentInfo& infoLoad) {
+    auto imageView = _graphStorage->getImageViewHolder(handle).getImageView().getImageView();
+    changed |= info.imageView != imageView;
+    info.imageView = imageView;
+    infoLoad.imageView = imageView;
+  };
+  for (int i = 0; i < _colorHandles.size(); i++) {
+    if (_colorHandles[i] != _swapchain)
+      update(_colorHandles[i], plan.colorAttachments[i], plan.colorAttachmentsLoad[i]);
+  }
+  if (_depthHandle.has_value()) update(_depthHandle.value(), plan.depthAttachment, plan.depthAttachmentLoad);
+  if (changed && _static) markDirty();
+}
 
-    graphElement->update(currentFrame, commandBuffer);
+void GraphPassGraphic::execute(int currentFrame, const CommandBuffer& commandBuffer, Timestamps* timestamps) {
+  int swapchainIndex = 0;
+  if (_swapchain.has_value()) swapchainIndex = _graphStorage->getImageViewHolder(_swapchain.value()).getIndex();
+  auto& plan = _renderingPlans[currentFrame * _swapchainImages + swapchainIndex];
+
+  // secondary command buffers are recorded every frame, so they can't be reused by static pass
+  if (_workersChunks && _static == false) {
+    VkCommandBufferInheritanceRenderingInfo inheritanceRendering{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .colorAttachmentCount = static_cast<uint32_t>(plan.colorFormats.size()),
+        .pColorAttachmentFormats = plan.colorFormats.data(),
+        .depthAttachmentFormat = plan.depthFormat,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT};
+    _recordChunks(currentFrame, true,
+                  VkCommandBufferInheritanceInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+                                                 .pNext = &inheritanceRendering},
+                  timestamps);
+
+    // updates can't be recorded inside rendering, so all of them go first and draws share one rendering scope
+    _executeChunks(currentFrame, true, commandBuffer);
+    auto renderingInfo = plan.renderingInfo;
+    renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
     vkCmdBeginRendering(commandBuffer.getCommandBuffer(), &renderingInfo);
-    graphElement->draw(currentFrame, commandBuffer);
+    _executeChunks(currentFrame, false, commandBuffer);
     vkCmdEndRendering(commandBuffer.getCommandBuffer());
+    return;
+  }
+
+  // the same as for parallel recording: updates first, then draws of all elements
+  for (auto&& graphElement : _graphElements) graphElement->update(currentFrame, commandBuffer);
+  // only the first scope clears attachments, element with its own scope splits the shared one
+  const VkRenderingInfo* renderingInfo = &plan.renderingInfo;
+  bool rendering = false;
+  for (int i = 0; i < _graphElements.size(); i++) {
+    bool separate = _graphElements[i]->isRenderingScopeSeparate();
+    if (rendering && separate) {
+      vkCmdEndRendering(commandBuffer.getCommandBuffer());
+      rendering = false;
+    }
+    if (rendering == false) {
+      vkCmdBeginRendering(commandBuffer.getCommandBuffer(), renderingInfo);
+      renderingInfo = &plan.renderingInfoLoad;
+      rendering = true;
+    }
+    _drawElement(i, currentFrame, commandBuffer, timestamps);
+    if (separate) {
+      vkCmdEndRendering(commandBuffer.getCommandBuffer());
+      rendering = false;
+    }
   }
+  if (rendering) vkCmdEndRendering(commandBuffer.getCommandBuffer());
 }
 
 GraphPassCompute::GraphPassCompute(std::string_view name,
@@ -212,8 +733,7 @@ GraphPassCompute::GraphPassCompute(std::string_view name,
                                    bool separate,
                                    const GraphStorage& graphStorage,
                                    const Device& device) noexcept
-    : GraphPass(name, GraphPassType::COMPUTE, graphStorage) {
-  _device = &device;
+    : GraphPass(name, GraphPassType::COMPUTE, graphStorage, device) {
   _separate = separate;
 
   auto queueType = vkb::QueueType::graphics;
@@ -257,10 +777,48 @@ const std::vector<std::string>& GraphPassCompute::getStorageTextureOutputs() con
 
 bool GraphPassCompute::isSeparate() const noexcept { return _separate; }
 
-void GraphPassCompute::execute(int currentFrame, const CommandBuffer& commandBuffer) {
-  for (auto&& graphElement : _graphElements) {
-    graphElement->draw(currentFrame, commandBuffer);
+std::vector<std::string> GraphPassCompute::getInputs() const noexcept {
+  auto inputs = _storageBufferInputs;
+  std::ranges::copy(_storageTextureInputs, std::back_inserter(inputs));
+  return inputs;
+}
+
+std::vector<std::string> GraphPassCompute::getOutputs() const noexcept {
+  auto outputs = _storageBufferOutputs;
+  std::ranges::copy(_storageTextureOutputs, std::back_inserter(outputs));
+  return outputs;
+}
+
+std::map<std::string, ResourceAccess> GraphPassCompute::getResourceAccesses() const noexcept {
+  std::map<std::string, ResourceAccess> accesses;
+  auto addAccess = [&accesses](const std::vector<std::string>& names, bool image, bool write) {
+    for (auto&& name : names) {
+      auto& access = accesses[name];
+      access.image = image;
+      access.stage |= VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+      if (write)
+        access.accessWrite |= VK_ACCESS_2_SHADER_WRITE_BIT;
+      else
+        access.accessRead |= VK_ACCESS_2_SHADER_READ_BIT;
+    }
+  };
+  addAccess(_storageBufferInputs, false, false);
+  addAccess(_storageBufferOutputs, false, true);
+  addAccess(_storageTextureInputs, true, false);
+  addAccess(_storageTextureOutputs, true, true);
+  return accesses;
+}
+
+void GraphPassCompute::execute(int currentFrame, const CommandBuffer& commandBuffer, Timestamps* timestamps) {
+  if (_workersChunks && _static == false) {
+    _recordChunks(currentFrame, false,
+                  VkCommandBufferInheritanceInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO},
+                  timestamps);
+    _executeChunks(currentFrame, false, commandBuffer);
+    return;
   }
+
+  for (int i = 0; i < _graphElements.size(); i++) _drawElement(i, currentFrame, commandBuffer, timestamps);
 }
 
 Graph::Graph(int threadsNumber,
@@ -268,33 +826,102 @@ Graph::Graph(int threadsNumber,
              Swapchain& swapchain,
              const Window& window,
              const Device& device) noexcept
-    : _swapchain(&swapchain),
-      _window(&window),
-      _device(&device) {
-  _threadPool = std::make_unique<BS::thread_pool>(threadsNumber);
+    : Graph(threadsNumber, maxFramesInFlight, device) {
+  _swapchain = &swapchain;
+  _window = &window;
+}
+
+Graph::Graph(int threadsNumber, int maxFramesInFlight, const Device& device) noexcept : _device(&device) {
+  if (threadsNumber > 0) _workers = std::make_unique<Workers>(threadsNumber);
   _timestamps = std::make_unique<Timestamps>(device);
+  _statistics = std::make_unique<FrameStatistics>();
+  _timestamps->setStatistics(_statistics.get());
   _graphStorage = std::make_unique<GraphStorage>();
   _maxFramesInFlight = maxFramesInFlight;
+  _framesInFlightLimit = maxFramesInFlight;
   _resetFrames = false;
   _commandPoolReset = std::make_unique<CommandPool>(vkb::QueueType::graphics, device);
   _commandBuffersReset = std::make_unique<CommandBuffer>(*_commandPoolReset, device);
 }
 
+Graph::~Graph() {
+  // graph is destroyed after GPU finishes its frames, deferred resources can reference its command pools
+  _device->destroyCompleted(std::numeric_limits<uint64_t>::max());
+}
+
 void Graph::initialize() noexcept {
-  // create 3 special semaphores
-  std::ranges::generate_n(std::back_inserter(_semaphoreImageAvailable), _maxFramesInFlight,
-                          [&] { return std::make_shared<Semaphore>(VK_SEMAPHORE_TYPE_BINARY, *_device); });
-  std::ranges::generate_n(std::back_inserter(_semaphoreRenderFinished), _swapchain->getImageCount(),
-                          [&] { return std::make_shared<Semaphore>(VK_SEMAPHORE_TYPE_BINARY, *_device); });
+  // create 3 special semaphores, headless graph needs only the timeline one
+  if (_swapchain) {
+    std::ranges::generate_n(std::back_inserter(_semaphoreImageAvailable), _maxFramesInFlight,
+                            [&] { return std::make_shared<Semaphore>(VK_SEMAPHORE_TYPE_BINARY, *_device); });
+    std::ranges::generate_n(std::back_inserter(_semaphoreRenderFinished), _swapchain->getImageCount(),
+                            [&] { return std::make_shared<Semaphore>(VK_SEMAPHORE_TYPE_BINARY, *_device); });
+  }
   _semaphoreInFlight = std::make_unique<Semaphore>(VK_SEMAPHORE_TYPE_TIMELINE, *_device);
 }
 
 GraphStorage& Graph::getGraphStorage() const noexcept { return *_graphStorage; }
 
-std::map<std::string, glm::dvec2> Graph::getTimestamps() const noexcept { return _timestamps->getTimestamps(); }
+std::map<std::string, glm::dvec2> Graph::getTimestamps(uint64_t* frame) const noexcept {
+  return _timestamps->getTimestamps(frame);
+}
 
 int Graph::getFrameInFlight() const noexcept { return _frameInFlight; }
 
+bool Graph::isHeadless() const noexcept { return _swapchain == nullptr; }
+
+uint64_t Graph::getFrameValue() const noexcept { return _valueSemaphoreInFlight; }
+
+void Graph::setMaxFramesInFlight(int maxFramesInFlight) {
+  if (maxFramesInFlight < 1 || maxFramesInFlight > _maxFramesInFlight)
+    throw std::runtime_error("Frames in flight limit has to be between 1 and the number passed to Graph");
+  _framesInFlightLimit = maxFramesInFlight;
+}
+
+int Graph::getMaxFramesInFlight() const noexcept { return _framesInFlightLimit; }
+
+void Graph::setFrameTime(std::chrono::nanoseconds frameTime) noexcept {
+  _frameTime = frameTime;
+  _frameDeadline = std::chrono::steady_clock::now();
+}
+
+void Graph::setTrace(Trace* trace) {
+  _trace = trace;
+  _timestamps->setTrace(trace);
+}
+
+void Graph::setPipelineStatistics(bool value) {
+  _pipelineStatistics.reset();
+  if (value) _pipelineStatistics = std::make_unique<PipelineStatistics>(*_device);
+}
+
+bool Graph::isPipelineStatistics() const noexcept { return _pipelineStatistics != nullptr; }
+
+std::map<std::string, PassStatistics> Graph::getPipelineStatistics(uint64_t* frame) const noexcept {
+  if (_pipelineStatistics == nullptr) {
+    if (frame) *frame = 0;
+    return {};
+  }
+  return _pipelineStatistics->getPipelineStatistics(frame);
+}
+
+void Graph::setStatisticsWindow(int frames) {
+  if (frames < 1) throw std::runtime_error("Statistics window has to have at least one frame");
+  _statisticsWindow = frames;
+}
+
+Percentiles Graph::getPassStatisticsGPU(std::string_view name) const noexcept { return _statistics->getPassGPU(name); }
+
+Percentiles Graph::getPassStatisticsCPU(std::string_view name) const noexcept { return _statistics->getPassCPU(name); }
+
+Percentiles Graph::getFrameStatisticsGPU() const noexcept { return _statistics->getFrameGPU(); }
+
+Percentiles Graph::getFrameStatisticsCPU() const noexcept { return _statistics->getFrameCPU(); }
+
+AliasingStatistics Graph::getAliasingStatistics() const noexcept { return _aliasingStatistics; }
+
+const std::vector<GraphPass*>& Graph::getPassesCulled() const noexcept { return _passesCulled; }
+
 GraphPassGraphic& Graph::createPassGraphic(std::string_view name) {
   auto it = std::find_if(_passes.begin(), _passes.end(),
                          [name = name](std::unique_ptr<GraphPass>& graphPass) { return graphPass->getName() == name; });
@@ -373,6 +1000,7 @@ void Graph::print() const noexcept {
     printRange(" wait semaphores: ", value->getWaitSemaphores(), [](auto* s) { return s->getSemaphore(); });
     printRange(" signal semaphores: ", value->getSignalSemaphores(), [](auto* s) { return s->getSemaphore(); });
     printRange(" command buffers: ", value->getCommandBuffers(), [](auto* c) { return c->getCommandBuffer(); });
+    printRange(" barriers: ", _cache.at(value).barriers, [](const auto& barrier) { return barrier.name; });
     if (value->getGraphPassType() == GraphPassType::GRAPHIC) {
       auto passGraphic = static_cast<GraphPassGraphic*>(value);
       printImages(passGraphic->getColorTargets(), " color target: ");
@@ -394,154 +1022,477 @@ void Graph::print() const noexcept {
       printImages(passCompute->getStorageTextureOutputs(), " storage texture output: ");
     }
   }
+
+  for (auto&& pass : _passesCulled) {
+    std::cout << "Culled: " << pass->getName() << std::endl;
+  }
+
+  if (_aliasingStatistics.naiveSize > 0)
+    std::cout << "Transient memory: naive " << _aliasingStatistics.naiveSize << " bytes, aliased "
+              << _aliasingStatistics.peakSize << " bytes" << std::endl;
 }
 
-void Graph::calculate() {
-  auto getInputs = [this](std::string_view nameNode) -> std::vector<std::string> {
-    auto it = std::find_if(
-        _passes.rbegin(), _passes.rend(),
-        [nameNode = nameNode](std::unique_ptr<GraphPass>& graphPass) { return graphPass->getName() == nameNode; });
-    auto value = (*it).get();
+void Graph::_alias(bool recreateBuffers) {
+  // passes on different queues overlap, so execution order doesn't bound lifetime of resources used by async compute
+  auto lifetimes = _lifetimes;
+  for (auto&& name : _resourcesAsync) lifetimes[name] = {0, static_cast<int>(_passesOrdered.size()) - 1};
+  _aliasingStatistics = _graphStorage->alias(lifetimes, *_device, recreateBuffers);
+  for (auto&& [pass, cache] : _cache) {
+    cache.aliasedImages.clear();
+    cache.aliasedBuffers = false;
+  }
+  for (auto&& name : _graphStorage->getAliasedImages())
+    _cache[_passesOrdered[_lifetimes.at(name).x]].aliasedImages.push_back(name);
+  for (auto&& name : _graphStorage->getAliasedBuffers())
+    _cache[_passesOrdered[_lifetimes.at(name).x]].aliasedBuffers = true;
+}
 
-    std::vector<std::string> dependencies;
-    if (value->getGraphPassType() == GraphPassType::COMPUTE) {
-      auto passCompute = static_cast<GraphPassCompute*>(value);
-      for (auto&& nameResource : passCompute->getStorageBufferInputs()) {
-        dependencies.push_back(nameResource);
-      }
-      for (auto&& nameResource : passCompute->getStorageTextureInputs()) {
-        dependencies.push_back(nameResource);
+void Graph::_compileBarriers() {
+  _swapchainImages = _swapchain ? _swapchain->getImageViews().size() : 1;
+  for (auto&& pass : _passesOrdered) {
+    auto& cache = _cache[pass];
+    // every image stays in GENERAL, so barriers without layout transition are the same for all resources and are
+    // merged to global memory barriers, one per pair of stages
+    std::vector<VkMemoryBarrier2> memoryBarriers;
+    auto addMemoryBarrier = [&memoryBarriers](VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+                                              VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+      auto memoryBarrier = std::ranges::find_if(memoryBarriers, [&](const VkMemoryBarrier2& memoryBarrier) {
+        return memoryBarrier.srcStageMask == srcStage && memoryBarrier.dstStageMask == dstStage;
+      });
+      if (memoryBarrier == memoryBarriers.end()) {
+        memoryBarriers.push_back({.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                                  .srcStageMask = srcStage,
+                                  .srcAccessMask = srcAccess,
+                                  .dstStageMask = dstStage,
+                                  .dstAccessMask = dstAccess});
+      } else {
+        memoryBarrier->srcAccessMask |= srcAccess;
+        memoryBarrier->dstAccessMask |= dstAccess;
       }
+    };
+    for (auto&& barrier : cache.barriers) {
+      // aliased image is transitioned from UNDEFINED instead
+      if (barrier.image && std::ranges::contains(cache.aliasedImages, barrier.name)) continue;
+      addMemoryBarrier(barrier.srcStage, barrier.srcAccess, barrier.dstStage, barrier.dstAccess);
     }
-
-    if (value->getGraphPassType() == GraphPassType::GRAPHIC) {
-      auto passGraphic = static_cast<GraphPassGraphic*>(value);
-      for (auto&& nameResource : passGraphic->getTextureInputs()) {
-        dependencies.push_back(nameResource);
+    // aliased buffers share memory with other buffers, wait for everything that could touch it
+    if (cache.aliasedBuffers)
+      addMemoryBarrier(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                       VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT);
+
+    cache.barrierBatches.assign(_maxFramesInFlight * _swapchainImages, BarrierBatch{.memoryBarriers = memoryBarriers});
+    for (int frame = 0; frame < _maxFramesInFlight; frame++) {
+      for (int swapchainIndex = 0; swapchainIndex < _swapchainImages; swapchainIndex++) {
+        auto& batch = cache.barrierBatches[frame * _swapchainImages + swapchainIndex];
+        // pass that waits for swapchain changes its layout to GENERAL, previous content of swapchain isn't needed
+        if (cache.acquireSwapchain) {
+          ResourceAccess access{.stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+          if (cache.accesses.contains(_nameSwapchain)) access = cache.accesses.at(_nameSwapchain);
+          batch.imageBarriers.push_back(_swapchain->getImage(swapchainIndex)
+                                            .getBarrier(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                                                        access.stage, VK_ACCESS_2_NONE, access.stage,
+                                                        access.accessRead | access.accessWrite));
+        }
+        // aliased resources share memory with other resources, so their content is undefined at the first use.
+        // Barriers go after the swapchain one and start with i-th copy for i-th frame in flight, copy picked by
+        // holder is set by _recordPass.
+        for (auto&& name : cache.aliasedImages) {
+          auto imageViews = _graphStorage->getImageViewHolder(name).getImageViews();
+          auto& image = imageViews[frame % imageViews.size()]->getImage();
+          auto& access = cache.accesses.at(name);
+          batch.imageBarriers.push_back(image.getBarrier(
+              VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+              VK_ACCESS_2_MEMORY_WRITE_BIT, access.stage, access.accessRead | access.accessWrite));
+          // layout is changed by GPU at the first use in every frame, nobody observes it on CPU before
+          for (auto&& imageView : imageViews) imageView->getImage().overrideLayout(VK_IMAGE_LAYOUT_GENERAL);
+        }
       }
     }
+  }
 
-    return dependencies;
+  // the last pass changes swapchain layout to present after the last use of swapchain, semaphore signal waits for it
+  _barriersPresent.clear();
+  for (int swapchainIndex = 0; _swapchain && swapchainIndex < _swapchainImages; swapchainIndex++) {
+    _barriersPresent.push_back(_swapchain->getImage(swapchainIndex)
+                                   .getBarrier(VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                               _swapchainAccessLast.stage, _swapchainAccessLast.accessWrite,
+                                               VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE));
+  }
+}
+
+void Graph::_compileRendering() {
+  // resources are looked up by name only here, execution uses precomputed plans
+  auto swapchain = _graphStorage->getImageHandle(_nameSwapchain);
+  auto& transient = _graphStorage->getTransient();
+  auto& exported = _graphStorage->getExported();
+  // content survives to the next frame unless it's transient or the first pass in frame clears it
+  auto isPersistent = [&](const std::string& name) {
+    if (transient.contains(name) || name == _nameSwapchain) return false;
+    auto first = _passesOrdered[_lifetimes.at(name).x];
+    return first->getGraphPassType() != GraphPassType::GRAPHIC ||
+           static_cast<GraphPassGraphic*>(first)->isCleared(name) == false;
   };
+  for (int i = 0; i < _passesOrdered.size(); i++) {
+    if (_passesOrdered[i]->getGraphPassType() != GraphPassType::GRAPHIC) continue;
+
+    auto pass = static_cast<GraphPassGraphic*>(_passesOrdered[i]);
+    // previous content of transient resource or swapchain is undefined at the first use in frame, content after the
+    // last use is needed only if somebody reads it: outside of the graph or in the next frame
+    std::set<std::string> discardBefore, discardAfter;
+    for (auto&& name : pass->getOutputs()) {
+      auto lifetime = _lifetimes.at(name);
+      if (lifetime.x == i && (transient.contains(name) || name == _nameSwapchain)) discardBefore.insert(name);
+      // swapchain is presented, it's consumed outside of the graph even if user doesn't export it
+      bool consumed = exported.contains(name) || name == _nameSwapchain;
+      if (lifetime.y == i && consumed == false && isPersistent(name) == false) discardAfter.insert(name);
+    }
+    pass->compile(_maxFramesInFlight, swapchain, discardBefore, discardAfter);
+  }
+}
 
-  auto findTarget = [](std::vector<GraphPass*> passes, std::string_view findName) -> GraphPass* {
-    for (auto pass : std::views::reverse(passes)) {
-      if (pass->getGraphPassType() == GraphPassType::GRAPHIC) {
-        auto passGraphic = static_cast<GraphPassGraphic*>(pass);
-        if (std::ranges::contains(passGraphic->getColorTargets(), findName) ||
-            passGraphic->getDepthTarget() == findName)
-          return pass;
-      }
+std::vector<std::unique_ptr<CommandBuffer>> Graph::_invalidateStatic() {
+  std::vector<std::unique_ptr<CommandBuffer>> commandBuffersOld;
+  for (auto&& pass : _passesOrdered)
+    std::ranges::move(pass->allocateCommandBuffersStatic(_maxFramesInFlight * _swapchainImages),
+                      std::back_inserter(commandBuffersOld));
+  return commandBuffersOld;
+}
+
+CommandBuffer* Graph::_getCommandBuffer(GraphPass* pass, int swapchainIndex) const noexcept {
+  if (auto commandBuffer = pass->getCommandBufferStatic(_frameInFlight * _swapchainImages + swapchainIndex))
+    return commandBuffer;
+  return pass->getCommandBuffer(_frameInFlight);
+}
+
+void Graph::calculate() {
+  // aliased resources, query pools, semaphores and command buffers are recreated below, so frames already submitted
+  // have to finish first. Unlike reset it isn't called every resize, so waiting is cheaper than deferring all of them.
+  if (_valueSemaphoreInFlight > 1) {
+    uint64_t waitValue = _valueSemaphoreInFlight - 1;
+    auto semaphoreInFlight = _semaphoreInFlight->getSemaphore();
+    VkSemaphoreWaitInfo waitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &semaphoreInFlight,
+        .pValues = &waitValue,
+    };
+    vkWaitSemaphores(_device->getLogicalDevice(), &waitInfo, std::numeric_limits<std::uint64_t>::max());
+    _device->destroyCompleted(waitValue);
+  }
+  _passesOrdered.clear();
+  _cache.clear();
+  _passesCulled.clear();
+  // acquire and cross-queue semaphores of the previous calculate, pass could have been culled since then
+  for (auto&& pass : _passes) pass->clearSemaphores();
+  _semaphoreJoin.clear();
+
+  // resources consumed outside of the graph: swapchain and everything user exported
+  auto exported = _graphStorage->getExported();
+  _nameSwapchain = _swapchain ? _graphStorage->find(_swapchain->getImageViews()) : "";
+  if (_nameSwapchain.empty() == false) exported.insert(_nameSwapchain);
+
+  // build dependencies between passes once from resource declarations, passes are referred by declaration index
+  int passNumber = _passes.size();
+  std::unordered_map<std::string, std::vector<int>> writers;
+  for (int i = 0; i < passNumber; i++) {
+    for (auto&& name : _passes[i]->getOutputs()) writers[name].push_back(i);
+  }
 
-      if (pass->getGraphPassType() == GraphPassType::COMPUTE) {
-        auto passCompute = static_cast<GraphPassCompute*>(pass);
-        if (std::ranges::contains(passCompute->getStorageBufferOutputs(), findName) ||
-            std::ranges::contains(passCompute->getStorageTextureOutputs(), findName))
-          return pass;
+  // producers: data dependencies (read after write, write after write), used for culling.
+  // successors: all edges including write after read, used for ordering and synchronization between queues.
+  std::vector<std::vector<int>> producers(passNumber), successors(passNumber);
+  auto addEdge = [&](int from, int to, bool data) {
+    if (from == to) return;
+    successors[from].push_back(to);
+    if (data) producers[to].push_back(from);
+  };
+  // targets are loaded, so every writer depends on the previous writer of the same resource
+  for (auto&& [name, passes] : writers) {
+    for (int i = 1; i < passes.size(); i++) addEdge(passes[i - 1], passes[i], true);
+  }
+  for (int i = 0; i < passNumber; i++) {
+    for (auto&& name : _passes[i]->getInputs()) {
+      auto it = writers.find(name);
+      // resource isn't produced by the graph (e.g. uploaded once), nothing to wait for
+      if (it == writers.end()) continue;
+
+      auto& passes = it->second;
+      auto previous = std::ranges::lower_bound(passes, i);
+      bool writes = previous != passes.end() && *previous == i;
+      if (previous != passes.begin()) {
+        addEdge(*std::prev(previous), i, true);
+        // next writer can't overwrite resource before this pass reads it
+        auto next = std::ranges::upper_bound(passes, i);
+        if (writes == false && next != passes.end()) addEdge(i, *next, false);
+      } else if (writes == false) {
+        // resource is written only by passes declared later, read the final version
+        addEdge(passes.back(), i, true);
       }
     }
-    return nullptr;
-  };
+  }
 
-  GraphPass* root = _passes.back().get();
-  auto passesBackup = _passes | std::views::transform([](auto& p) { return p.get(); }) |
-                      std::ranges::to<std::vector<GraphPass*>>();
-  // we should for every root pass run traversal process
-  std::function<void(GraphPass*)> traverse = [&](GraphPass* node) {
-    if (passesBackup.empty()) return;
-
-    passesBackup.erase(std::remove(passesBackup.begin(), passesBackup.end(), node), passesBackup.end());
-    _passesOrdered.push_front(node);
-
-    auto inputs = getInputs(node->getName());
-    if (inputs.empty()) {
-      // this means that stage depends only on it's frame buffer attachment
-      if (node->getGraphPassType() == GraphPassType::GRAPHIC) {
-        auto passGraphic = static_cast<GraphPassGraphic*>(node);
-        inputs = passGraphic->getColorTargets();
-      }
+  // cull passes: alive are passes that write exported resources and everything they transitively depend on
+  std::vector<bool> alive(passNumber, false);
+  std::vector<int> stack;
+  for (int i = 0; i < passNumber; i++) {
+    if (std::ranges::any_of(_passes[i]->getOutputs(), [&](const auto& name) { return exported.contains(name); })) {
+      alive[i] = true;
+      stack.push_back(i);
     }
-    std::vector<GraphPass*> passNext =
-        inputs | std::views::transform([&](auto& input) { return findTarget(passesBackup, input); }) |
-        std::views::filter([](GraphPass* p) { return p != nullptr; }) | std::ranges::to<std::vector>();
+  }
+  while (stack.empty() == false) {
+    int current = stack.back();
+    stack.pop_back();
+    for (auto producer : producers[current]) {
+      if (alive[producer]) continue;
+      alive[producer] = true;
+      stack.push_back(producer);
+    }
+  }
 
-    for (auto&& pass : passNext) traverse(pass);
-  };
+  // Kahn's algorithm, ready passes are taken in declaration order so result is deterministic
+  std::vector<int> inDegree(passNumber, 0);
+  for (int i = 0; i < passNumber; i++) {
+    if (alive[i] == false) {
+      _passesCulled.push_back(_passes[i].get());
+      continue;
+    }
+    for (auto successor : successors[i]) {
+      if (alive[successor]) inDegree[successor]++;
+    }
+  }
+  std::vector<int> ready;
+  ready.reserve(passNumber);
+  for (int i = 0; i < passNumber; i++) {
+    if (alive[i] && inDegree[i] == 0) ready.push_back(i);
+  }
+  for (int head = 0; head < ready.size(); head++) {
+    int current = ready[head];
+    _passesOrdered.push_back(_passes[current].get());
+    for (auto successor : successors[current]) {
+      if (alive[successor] && --inDegree[successor] == 0) ready.push_back(successor);
+    }
+    auto& cache = _cache[_passes[current].get()];
+    cache.accesses = _passes[current]->getResourceAccesses();
+    // all predecessors are already ordered
+    for (auto successor : successors[current]) {
+      auto& dependencies = _cache[_passes[successor].get()].dependencies;
+      if (alive[successor] && std::ranges::contains(dependencies, _passes[current].get()) == false)
+        dependencies.push_back(_passes[current].get());
+    }
+  }
 
-  if (root) traverse(root);
+  if (_passesOrdered.size() != passNumber - _passesCulled.size()) {
+    std::string cycle;
+    for (int i = 0; i < passNumber; i++) {
+      if (alive[i] && inDegree[i] > 0) cycle += _passes[i]->getName() + " ";
+    }
+    throw std::runtime_error("Graph has a cycle between passes: " + cycle);
+  }
+  // frame would have nothing to submit, swapchain image would be acquired and never presented
+  if (_passesOrdered.empty())
+    throw std::runtime_error("Graph has no passes left after culling, nothing writes exported resources or swapchain");
+
+  _recordTasks = std::make_unique<RecordTask[]>(_passesOrdered.size());
+  // every ordered pass can be pending at once
+  if (_workers) _workers->reserve(_passesOrdered.size());
+  // every pass has its own queries, pool is sized from ordered passes and element scopes
+  auto isSeparate = [](GraphPass* pass) {
+    return pass->getGraphPassType() == GraphPassType::COMPUTE && static_cast<GraphPassCompute*>(pass)->isSeparate();
+  };
+  std::vector<std::string> passNames, passTracks;
+  std::vector<uint8_t> passesCompute;
+  int scopeNumber = 0;
+  for (int i = 0; i < _passesOrdered.size(); i++) {
+    _recordTasks[i].graph = this;
+    _recordTasks[i].index = i;
+    passNames.push_back(_passesOrdered[i]->getName());
+    passTracks.push_back(isSeparate(_passesOrdered[i]) ? "Compute queue" : "Graphics queue");
+    passesCompute.push_back(isSeparate(_passesOrdered[i]));
+    scopeNumber += _passesOrdered[i]->compileTimestamps();
+  }
+  _timestamps->initialize(passNames, passTracks, scopeNumber, _maxFramesInFlight);
+  if (_pipelineStatistics) _pipelineStatistics->initialize(passNames, passesCompute, _maxFramesInFlight);
+  _statistics->initialize(passNames, _statisticsWindow);
+
+  // who first interact with swapchain that should wait for the semaphore at the stage it uses swapchain,
+  // if swapchain isn't used by graph it still has to be acquired and presented. Headless graph has nothing to
+  // acquire, all passes are submitted as passes before the acquire.
+  GraphPass* passAcquire = nullptr;
+  _indexAcquire = _passesOrdered.size();
+  if (_swapchain) {
+    passAcquire = _passesOrdered.front();
+    if (auto pass = std::ranges::find_if(_passesOrdered, [this](GraphPass* pass) {
+          return _cache[pass].accesses.contains(_nameSwapchain);
+        });
+        pass != _passesOrdered.end()) {
+      passAcquire = *pass;
+      passAcquire->addWaitSemaphore(_semaphoreImageAvailable, [this]() { return _frameInFlight; },
+                                    _cache[passAcquire].accesses.at(_nameSwapchain).stage);
+    } else {
+      passAcquire->addWaitSemaphore(_semaphoreImageAvailable, [this]() { return _frameInFlight; });
+    }
+    _cache[passAcquire].acquireSwapchain = true;
+    _indexAcquire = std::distance(_passesOrdered.begin(), std::ranges::find(_passesOrdered, passAcquire));
+  }
+  for (auto&& pass : _passesOrdered) {
+    auto& cache = _cache[pass];
+    cache.swapchainDependent = cache.acquireSwapchain || cache.accesses.contains(_nameSwapchain);
+  }
 
-  // set semaphores between passes
-  bool flagWaitForSwapchain = true;
-  bool queueTypeChange = false;
-  GraphPass* previousPass = nullptr;
+  // queues are synchronized only where passes depend on each other, independent passes on graphics and compute
+  // queues overlap. Pass that waits for the other queue starts a new submission, so passes recorded before it in the
+  // same queue aren't blocked, pass that the other queue waits for ends submission, so it's signaled as soon as
+  // possible.
+  std::set<GraphPass*> passesSignal;
   for (auto&& pass : _passesOrdered) {
-    // find if we need to change queue -> add semaphore
-    if (previousPass) {
-      if (pass->getGraphPassType() != previousPass->getGraphPassType()) {
-        if ((previousPass->getGraphPassType() == GraphPassType::COMPUTE &&
-             static_cast<GraphPassCompute*>(previousPass)->isSeparate()) ||
-            (pass->getGraphPassType() == GraphPassType::COMPUTE && static_cast<GraphPassCompute*>(pass)->isSeparate()))
-          queueTypeChange = true;
-      } else {
-        if (previousPass->getGraphPassType() == GraphPassType::COMPUTE &&
-            pass->getGraphPassType() == GraphPassType::COMPUTE &&
-            static_cast<GraphPassCompute*>(previousPass)->isSeparate() !=
-                static_cast<GraphPassCompute*>(pass)->isSeparate())
-          queueTypeChange = true;
-      }
+    auto& cache = _cache[pass];
+    for (auto&& dependency : cache.dependencies) {
+      if (isSeparate(dependency) == isSeparate(pass)) continue;
+
+      VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE;
+      for (auto&& [name, access] : cache.accesses) stage |= access.stage;
+      if (stage == VK_PIPELINE_STAGE_2_NONE) stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+      std::vector<std::shared_ptr<Semaphore>> semaphoreQueue(_maxFramesInFlight);
+      std::ranges::generate(semaphoreQueue,
+                            [&] { return std::make_shared<Semaphore>(VK_SEMAPHORE_TYPE_BINARY, *_device); });
+      pass->addWaitSemaphore(semaphoreQueue, [this]() { return _frameInFlight; }, stage);
+      dependency->addSignalSemaphore(semaphoreQueue, [this]() { return _frameInFlight; });
+      cache.waitQueue = true;
+      passesSignal.insert(dependency);
     }
+  }
+  GraphPass* previousPass = nullptr;
+  for (auto&& pass : _passesOrdered) {
+    auto& cache = _cache[pass];
+    cache.previousPass = previousPass;
+    cache.newSubmission = previousPass && (isSeparate(previousPass) != isSeparate(pass) || cache.waitQueue ||
+                                           cache.acquireSwapchain || passesSignal.contains(previousPass));
+    previousPass = pass;
+  }
 
-    _cache[pass] = {queueTypeChange, previousPass};
-
-    // signal semaphore for the previous pass
-    // wait semaphore for the current pass
-    // only if there are separate queues for compute and graphic
-    if (queueTypeChange) {
-      std::vector<std::shared_ptr<Semaphore>> semaphoreQueueType(_maxFramesInFlight);
-      std::ranges::generate(semaphoreQueueType,
+  // frame is finished when both queues are finished: if nobody from the final queue waits for the last pass of the
+  // other queue, it signals semaphore that is waited before timeline semaphore is signaled
+  auto passLast = _passesOrdered.back();
+  auto passesReversed = _passesOrdered | std::views::reverse;
+  auto passOtherQueue = std::ranges::find_if(
+      passesReversed, [&](GraphPass* pass) { return isSeparate(pass) != isSeparate(passLast); });
+  if (passOtherQueue != passesReversed.end() && passesSignal.contains(*passOtherQueue) == false) {
+    std::ranges::generate_n(std::back_inserter(_semaphoreJoin), _maxFramesInFlight,
                             [&] { return std::make_shared<Semaphore>(VK_SEMAPHORE_TYPE_BINARY, *_device); });
-      pass->addWaitSemaphore(semaphoreQueueType, [this]() { return _frameInFlight; });
-      previousPass->addSignalSemaphore(semaphoreQueueType, [this]() { return _frameInFlight; });
-      queueTypeChange = false;
-    }
-    // special case if we read from swapchain
-    // who first interact with swapchain that should wait for the semaphore
-    if (flagWaitForSwapchain) {
-      bool swapchainFound = false;
-      auto checkSwapchain = [this](const auto& input) -> bool {
-        for (auto&& name : input)
-          if (_graphStorage->getImageViewHolder(name).contains(_swapchain->getImageViews())) return true;
-        return false;
-      };
-      if (pass->getGraphPassType() == GraphPassType::GRAPHIC) {
-        auto passGraphic = static_cast<GraphPassGraphic*>(pass);
-        if (checkSwapchain(passGraphic->getColorTargets()) || checkSwapchain(passGraphic->getTextureInputs()))
-          swapchainFound = true;
-      }
-      if (pass->getGraphPassType() == GraphPassType::COMPUTE) {
-        auto passCompute = static_cast<GraphPassCompute*>(pass);
-        if (checkSwapchain(passCompute->getStorageTextureInputs()) ||
-            checkSwapchain(passCompute->getStorageTextureOutputs()))
-          swapchainFound = true;
-      }
-      if (swapchainFound) {
-        pass->addWaitSemaphore(_semaphoreImageAvailable, [this]() { return _frameInFlight; });
-        flagWaitForSwapchain = false;
+    (*passOtherQueue)->addSignalSemaphore(_semaphoreJoin, [this]() { return _frameInFlight; });
+  }
+
+  // barriers inside one queue, order between queues is guaranteed by semaphores
+  struct State {
+    VkPipelineStageFlags2 writeStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+    // stages that read resource after the last write
+    VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+    // stages and accesses the last write has already been made visible to
+    VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
+  };
+  // state of resource is tracked per queue: conflicting accesses from different queues always depend on each other
+  std::map<std::pair<std::string, bool>, State> states;
+  _swapchainAccessLast = ResourceAccess{.stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+  _passSwapchainLast = passAcquire;
+  // resources not recreated every frame are used by the previous frame on the same queue: the first round only
+  // collects state left by the previous frame, barriers are taken from the second one
+  for (int round = 0; round < 2; round++) {
+    for (auto&& pass : _passesOrdered) {
+      auto& cache = _cache[pass];
+      for (auto&& [name, access] : cache.accesses) {
+        auto& state = states[{name, isSeparate(pass)}];
+        ResourceBarrier barrier{.name = name,
+                                .image = access.image,
+                                .srcStage = state.writeStage,
+                                .srcAccess = state.writeAccess,
+                                .dstStage = access.stage,
+                                .dstAccess = access.accessRead | access.accessWrite};
+        bool write = access.accessWrite != VK_ACCESS_2_NONE;
+        // write after read needs only execution dependency
+        if (write) barrier.srcStage |= state.readStages;
+        // previous barrier covers this read too: read after read needs nothing
+        bool visible = (access.stage & ~state.visibleStages) == 0 && (access.accessRead & ~state.visibleAccess) == 0;
+        // swapchain is synchronized by the acquire semaphore
+        bool acquire = cache.acquireSwapchain && name == _nameSwapchain;
+        if (round == 1 && acquire == false && (write || visible == false) &&
+            barrier.srcStage != VK_PIPELINE_STAGE_2_NONE)
+          cache.barriers.push_back(barrier);
+
+        if (write) {
+          state.writeStage = access.stage;
+          state.writeAccess = access.accessWrite;
+          state.readStages = VK_PIPELINE_STAGE_2_NONE;
+          state.visibleStages = VK_PIPELINE_STAGE_2_NONE;
+          state.visibleAccess = VK_ACCESS_2_NONE;
+        } else {
+          state.readStages |= access.stage;
+          state.visibleStages |= access.stage;
+          state.visibleAccess |= access.accessRead;
+        }
+        if (name == _nameSwapchain) {
+          _swapchainAccessLast = access;
+          _passSwapchainLast = pass;
+        }
       }
     }
-    // end node should signal end semaphore
-    if (pass == root) {
-      pass->addSignalSemaphore(_semaphoreRenderFinished, [this]() { return _swapchain->getSwapchainIndex(); });
+  }
+
+  // lifetime of resource is range of passes in execution order that use it
+  _lifetimes.clear();
+  _resourcesAsync.clear();
+  for (int i = 0; i < _passesOrdered.size(); i++) {
+    auto resources = _passesOrdered[i]->getInputs();
+    std::ranges::copy(_passesOrdered[i]->getOutputs(), std::back_inserter(resources));
+    for (auto&& name : resources) {
+      if (_lifetimes.contains(name) == false) _lifetimes[name] = {i, i};
+      _lifetimes[name].y = i;
+      if (isSeparate(_passesOrdered[i])) _resourcesAsync.insert(name);
     }
+  }
 
-    previousPass = pass;
+  _alias();
+  // aliased and restored resources are recreated, so elements have to update everything that references them (e.g.
+  // descriptors)
+  if (_graphStorage->getAliasedImages().empty() == false || _graphStorage->getAliasedBuffers().empty() == false ||
+      _graphStorage->getRestored().empty() == false) {
+    _commandBuffersReset->beginCommands();
+    // restored images aren't transitioned at the first use like aliased ones
+    for (auto&& name : _graphStorage->getRestored()) {
+      auto handle = _graphStorage->getImageHandle(name);
+      if (handle.index < 0) continue;
+      for (auto&& imageView : _graphStorage->getImageViewHolder(handle).getImageViews())
+        imageView->getImage().changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE,
+                                           VK_ACCESS_NONE, *_commandBuffersReset);
+    }
+    for (auto&& pass : _passesOrdered) {
+      pass->reset(_swapchain ? _swapchain->getImageViews() : std::vector<std::shared_ptr<ImageView>>{},
+                  *_commandBuffersReset);
+    }
+    _endCommandsReset();
   }
+  _compileRendering();
+  _compileBarriers();
+  _invalidateStatic();
 }
 
-bool Graph::render() {
-  // timeline semaphore instead of fence
-  if (_valueSemaphoreInFlight > _maxFramesInFlight) {
-    uint64_t waitValue = _valueSemaphoreInFlight - _maxFramesInFlight;
+void Graph::_beginFrame(int iterations) {
+  // CPU frame limiter sleeps instead of spinning, frame late by more than a frame time doesn't make next frames
+  // catch up
+  if (_frameTime.count() > 0) {
+    TraceScope traceScope(_trace, "Frame limiter", _valueSemaphoreInFlight);
+    std::this_thread::sleep_until(_frameDeadline);
+    auto now = std::chrono::steady_clock::now();
+    _frameDeadline = (now - _frameDeadline < _frameTime) ? _frameDeadline + _frameTime : now + _frameTime;
+  }
+  // timeline semaphore instead of fence, CPU can't get ahead of GPU by more than the limit of frames in flight.
+  // Batch reuses frames in flight of all its iterations, so it waits for the last one.
+  uint64_t valueLast = _valueSemaphoreInFlight + iterations - 1;
+  if (valueLast > _framesInFlightLimit) {
+    uint64_t waitValue = valueLast - _framesInFlightLimit;
     auto semaphoreInFlight = _semaphoreInFlight->getSemaphore();
     VkSemaphoreWaitInfo waitInfo = {
         .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
@@ -551,182 +1502,278 @@ bool Graph::render() {
         .pValues = &waitValue,
     };
 
+    TraceScope traceScope(_trace, "Wait frame", _valueSemaphoreInFlight);
     vkWaitSemaphores(_device->getLogicalDevice(), &waitInfo, std::numeric_limits<std::uint64_t>::max());
   }
+  // free everything finished frames used
+  uint64_t valueFinished = 0;
+  vkGetSemaphoreCounterValue(_device->getLogicalDevice(), _semaphoreInFlight->getSemaphore(), &valueFinished);
+  _device->destroyCompleted(valueFinished);
+  // clocks drift apart, so they are aligned every frame
+  if (_trace) _trace->setCalibration(_timestamps->getCalibration());
 
-  auto status = _swapchain->acquireNextImage(*_semaphoreImageAvailable[_frameInFlight]);
-  // notify about reset needed
-  if (status == VK_ERROR_OUT_OF_DATE_KHR) {
-    return true;
-  } else if (status != VK_SUCCESS && status != VK_SUBOPTIMAL_KHR) {
-    throw std::runtime_error("failed to acquire swap chain image");
+  if (_resetFrames) {
+    _addSubmission(vkb::QueueType::graphics)
+        .commandBuffers.push_back({.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                   .commandBuffer = _commandBuffersReset->getCommandBuffer()});
+    _resetFrames = false;
   }
+}
 
-  auto swapchainIndex = _swapchain->getSwapchainIndex();
-  _timestamps->resetQueryPool();
-  // run all passes' execution functions
-  std::vector<std::future<void>> futureTasks =
-      _passesOrdered | std::views::transform([this, swapchainIndex](auto& pass) {
-        auto commandBuffer = pass->getCommandBuffers()[_frameInFlight];
-        if (commandBuffer->getActive() == false) commandBuffer->beginCommands();
-        // first pass changes swapchain layout to GENERAL, because by default it's UNDEFINED
-        if (_swapchain->getImage(swapchainIndex).getImageLayout() != VK_IMAGE_LAYOUT_GENERAL) {
-          _swapchain->getImage(swapchainIndex)
-              .changeLayout(_swapchain->getImage(swapchainIndex).getImageLayout(), VK_IMAGE_LAYOUT_GENERAL,
-                            VK_ACCESS_NONE, VK_ACCESS_NONE, *pass->getCommandBuffers()[_frameInFlight]);
-        }
-
-        return _threadPool->submit([this, pass, commandBuffer]() {
-          _timestamps->pushTimestamp(pass->getName(), *commandBuffer);
-          pass->execute(_frameInFlight, *commandBuffer);
-          _timestamps->popTimestamp(pass->getName(), *commandBuffer);
-        });
-      }) |
-      std::ranges::to<std::vector<std::future<void>>>();
-
-  auto submitPassToQueue = [this](GraphPass* previousPass, const std::vector<CommandBuffer*>& commandBufferSubmit,
-                                  const std::vector<VkSemaphore>& waitSemaphores,
-                                  const std::vector<VkSemaphore>& signalSemaphores,
-                                  std::optional<VkTimelineSemaphoreSubmitInfo> signalTimelineInfo = std::nullopt) {
-    // need to end command buffers before submit
-    std::vector<VkCommandBuffer> commandBufferRawSubmit;
-    commandBufferRawSubmit.reserve(commandBufferSubmit.size());
-    for (auto&& commandBuffer : commandBufferSubmit) {
-      commandBuffer->endCommands();
-      commandBufferRawSubmit.push_back(commandBuffer->getCommandBuffer());
-    }
-
-    // determine wait stages
-    std::vector<VkPipelineStageFlags> waitStages(waitSemaphores.size(), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-    auto queueType = vkb::QueueType::graphics;
-    if (previousPass->getGraphPassType() == GraphPassType::COMPUTE) {
-      auto passComputePrevious = static_cast<GraphPassCompute*>(previousPass);
-      std::ranges::fill(waitStages, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-      if (passComputePrevious->isSeparate()) queueType = vkb::QueueType::compute;
-    }
-
-    // submit + semaphores
-    VkSubmitInfo submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                            .pNext = signalTimelineInfo ? &signalTimelineInfo.value() : nullptr,
-                            .waitSemaphoreCount = (uint32_t)waitSemaphores.size(),
-                            .pWaitSemaphores = waitSemaphores.data(),
-                            .pWaitDstStageMask = waitStages.data(),
-                            .commandBufferCount = (uint32_t)commandBufferRawSubmit.size(),
-                            .pCommandBuffers = commandBufferRawSubmit.data(),
-                            .signalSemaphoreCount = (uint32_t)signalSemaphores.size(),
-                            .pSignalSemaphores = signalSemaphores.data()};
-
-    vkQueueSubmit(_device->getQueue(queueType), 1, &submitInfo, nullptr);
-  };
+void Graph::RecordTask::execute() {
+  TraceScope traceScope(graph->_trace, pass->getName(), graph->_valueSemaphoreInFlight);
+  auto begin = std::chrono::steady_clock::now();
+  // timestamps are written every frame, so they can't be baked to reused command buffer
+  if (pass->isStatic() || timestamps == false) {
+    pass->execute(graph->_frameInFlight, *commandBuffer, nullptr);
+  } else {
+    // query can't stay active while secondary command buffers of parallel recording are executed
+    auto pipelineStatistics = pass->isParallelRecording() ? nullptr : graph->_pipelineStatistics.get();
+    graph->_timestamps->beginPass(index, *commandBuffer);
+    if (pipelineStatistics) pipelineStatistics->beginPass(index, *commandBuffer);
+    pass->execute(graph->_frameInFlight, *commandBuffer, graph->_timestamps.get());
+    if (pipelineStatistics) pipelineStatistics->endPass(index, *commandBuffer);
+    graph->_timestamps->endPass(index, *commandBuffer);
+  }
+  recordTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+  done = true;
+  done.notify_one();
+}
 
-  if (_resetFrames) {
-    auto queueType = vkb::QueueType::graphics;
-    VkSubmitInfo submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                            .commandBufferCount = 1u,
-                            .pCommandBuffers = &_commandBuffersReset->getCommandBuffer()};
+void Graph::_recordPass(int index, int swapchainIndex, bool timestamps) {
+  auto pass = _passesOrdered[index];
+  auto& cache = _cache[pass];
+  // attachments of the pass are described with the current layout
+  if (cache.acquireSwapchain) _swapchain->getImage(swapchainIndex).overrideLayout(VK_IMAGE_LAYOUT_GENERAL);
+  auto commandBuffer = _getCommandBuffer(pass, swapchainIndex);
+  auto& batch = cache.barrierBatches[_frameInFlight * _swapchainImages + swapchainIndex];
+  // copies of aliased images and attachments are picked by their holders, static pass recorded with other copies is
+  // recorded again
+  for (int i = 0; i < cache.aliasedImages.size(); i++) {
+    auto image = _graphStorage->getImageViewHolder(cache.aliasedImages[i]).getImageView().getImage().getImage();
+    auto& barrier = batch.imageBarriers[(cache.acquireSwapchain ? 1 : 0) + i];
+    if (barrier.image != image && pass->isStatic()) pass->markDirty();
+    barrier.image = image;
+  }
+  if (pass->getGraphPassType() == GraphPassType::GRAPHIC)
+    static_cast<GraphPassGraphic*>(pass)->updateAttachments(_frameInFlight, swapchainIndex);
+  // static pass is resubmitted as is if nothing has changed since it was recorded
+  if (commandBuffer != pass->getCommandBuffer(_frameInFlight)) {
+    int indexStatic = _frameInFlight * _swapchainImages + swapchainIndex;
+    if (pass->isRecorded(indexStatic)) return;
+    pass->setRecorded(indexStatic);
+    commandBuffer->beginCommands(0);
+  } else if (commandBuffer->getActive() == false) {
+    commandBuffer->beginCommands();
+  }
+  // barriers are recorded at the beginning of the pass before it's dispatched, so they don't depend on recording
+  // of other passes. All of them are precomputed and submitted by one call.
+  if (batch.memoryBarriers.empty() == false || batch.imageBarriers.empty() == false) {
+    VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .memoryBarrierCount = static_cast<uint32_t>(batch.memoryBarriers.size()),
+                                    .pMemoryBarriers = batch.memoryBarriers.data(),
+                                    .imageMemoryBarrierCount = static_cast<uint32_t>(batch.imageBarriers.size()),
+                                    .pImageMemoryBarriers = batch.imageBarriers.data()};
+    vkCmdPipelineBarrier2(commandBuffer->getCommandBuffer(), &dependencyInfo);
+  }
 
-    vkQueueSubmit(_device->getQueue(queueType), 1, &submitInfo, nullptr);
-    _resetFrames = false;
+  auto& task = _recordTasks[index];
+  task.pass = pass;
+  task.commandBuffer = commandBuffer;
+  task.timestamps = timestamps;
+  if (_workers == nullptr) {
+    task.execute();
+    return;
   }
+  task.done = false;
+  _workers->push(task);
+}
 
-  // command buffer from passes
-  std::vector<CommandBuffer*> commandBufferSubmit;
-  std::vector<VkSemaphore> signalSemaphores;
-  std::vector<VkSemaphore> waitSemaphores;
-  // submit recorded command buffer to GPU
-  for (auto&& [pass, futureTask] : std::views::zip(_passesOrdered, futureTasks)) {
-    // wait execution of current render pass
-    if (futureTask.valid()) futureTask.get();
+void Graph::_waitPass(int index) {
+  auto& task = _recordTasks[index];
+  task.done.wait(false);
+  // static pass that isn't recorded again has no sample
+  if (task.recordTime >= 0) _statistics->addPassCPU(index, task.recordTime);
+  task.recordTime = -1;
+}
 
-    auto [queueTypeChange, previousPass] = _cache[pass];
+Graph::Submission& Graph::_addSubmission(vkb::QueueType queueType) {
+  if (_submissionNumber == _submissions.size()) _submissions.emplace_back();
+  auto& submission = _submissions[_submissionNumber++];
+  submission.queueType = queueType;
+  submission.commandBuffers.clear();
+  submission.waitSemaphores.clear();
+  submission.signalSemaphores.clear();
+  return submission;
+}
 
-    if (previousPass) {
-      if (queueTypeChange) {
-        submitPassToQueue(previousPass, commandBufferSubmit, waitSemaphores, signalSemaphores);
-        //
-        commandBufferSubmit.clear();
-        signalSemaphores.clear();
-        waitSemaphores.clear();
-      } else {
-        // put EXECUTION AND MEMORY barriers if needed (not layout transition ones)
-        // IMPORTANT: we should add any barrier to the previous stage because potentially all command buffer are already
-        // recorded. So we need to add barrier to the end of the previous command buffer.
-        auto calculateImageBarriers = [this](auto range, VkAccessFlags srcMask, VkAccessFlags dstMask) {
-          std::vector<VkImageMemoryBarrier> imageBarriers;
-          for (auto&& item : range) {
-            auto& image = _graphStorage->getImageViewHolder(item).getImageView().getImage();
-            imageBarriers.push_back(VkImageMemoryBarrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-                                                         .srcAccessMask = srcMask,
-                                                         .dstAccessMask = dstMask,
-                                                         .oldLayout = image.getImageLayout(),
-                                                         .newLayout = image.getImageLayout(),
-                                                         .image = image.getImage(),
-                                                         .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}});
-          }
+void Graph::_submitPass(GraphPass* pass, int swapchainIndex) {
+  auto& cache = _cache[pass];
+  auto queueType = vkb::QueueType::graphics;
+  if (pass->getGraphPassType() == GraphPassType::COMPUTE && static_cast<GraphPassCompute*>(pass)->isSeparate())
+    queueType = vkb::QueueType::compute;
+  // passes before acquire can be already flushed, the next batch iteration can start on the other queue
+  bool continued = _submissionNumber > 0 && _submissions[_submissionNumber - 1].queueType == queueType;
+  auto& submission =
+      cache.newSubmission || continued == false ? _addSubmission(queueType) : _submissions[_submissionNumber - 1];
+
+  // the last user of swapchain changes its layout to present
+  // (reused command buffer already contains it)
+  auto commandBuffer = _getCommandBuffer(pass, cache.swapchainDependent ? swapchainIndex : 0);
+  if (pass == _passSwapchainLast && commandBuffer->getActive()) {
+    VkDependencyInfo dependencyPresent{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                       .imageMemoryBarrierCount = 1,
+                                       .pImageMemoryBarriers = &_barriersPresent[swapchainIndex]};
+    vkCmdPipelineBarrier2(commandBuffer->getCommandBuffer(), &dependencyPresent);
+  }
+  // need to end command buffers before submit, reused command buffers are already ended
+  if (commandBuffer->getActive()) commandBuffer->endCommands();
+  submission.commandBuffers.push_back(
+      {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO, .commandBuffer = commandBuffer->getCommandBuffer()});
+
+  // the last user of swapchain notifies presentation engine, swapchain can be recreated with more images, so the
+  // semaphore isn't bound to pass
+  if (pass == _passSwapchainLast)
+    submission.signalSemaphores.push_back({.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = _semaphoreRenderFinished[swapchainIndex]->getSemaphore(),
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT});
+  for (int i = 0; i < pass->getSignalSemaphoreNumber(); i++) {
+    submission.signalSemaphores.push_back({.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = pass->getSignalSemaphore(i)->getSemaphore(),
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT});
+  }
+  for (int i = 0; i < pass->getWaitSemaphoreNumber(); i++) {
+    submission.waitSemaphores.push_back({.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                         .semaphore = pass->getWaitSemaphore(i)->getSemaphore(),
+                                         .stageMask = pass->getWaitStages()[i]});
+  }
+}
 
-          return imageBarriers;
-        };
-
-        auto calculateBufferBarriers = [this](auto range, VkAccessFlags srcMask, VkAccessFlags dstMask) {
-          std::vector<VkBufferMemoryBarrier> bufferBarriers;
-          for (auto&& item : range) {
-            auto buffer = _graphStorage->getBuffer(item)[_frameInFlight];
-            bufferBarriers.push_back(VkBufferMemoryBarrier{.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-                                                           .srcAccessMask = srcMask,
-                                                           .dstAccessMask = dstMask,
-                                                           .buffer = buffer->getBuffer(),
-                                                           .size = buffer->getSize()});
-          }
+void Graph::_submitFrameEnd(bool signal) {
+  VkSemaphoreSubmitInfo signalInFlight{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                       .semaphore = _semaphoreInFlight->getSemaphore(),
+                                       .value = _valueSemaphoreInFlight,
+                                       .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+  // frame is finished when both queues are finished
+  if (_semaphoreJoin.empty() == false) {
+    // empty submission: signal operation waits for everything submitted to the queue before
+    _addSubmission(_submissions[_submissionNumber - 1].queueType)
+        .waitSemaphores.push_back({.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                   .semaphore = _semaphoreJoin[_frameInFlight]->getSemaphore(),
+                                   .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT});
+  }
+  if (signal) _submissions[_submissionNumber - 1].signalSemaphores.push_back(signalInFlight);
+}
 
-          return bufferBarriers;
-        };
+void Graph::_flushSubmissions() {
+  TraceScope traceScope(_trace, "Submit", _valueSemaphoreInFlight);
+  // submissions to the same queue in a row go by one call, the other queue is flushed first, so binary semaphores
+  // are always waited after their signal is submitted
+  for (int i = 0; i < _submissionNumber; i++) {
+    auto& submission = _submissions[i];
+    // submit + semaphores, every wait semaphore has its own stage
+    _submitInfos.push_back({.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                            .waitSemaphoreInfoCount = static_cast<uint32_t>(submission.waitSemaphores.size()),
+                            .pWaitSemaphoreInfos = submission.waitSemaphores.data(),
+                            .commandBufferInfoCount = static_cast<uint32_t>(submission.commandBuffers.size()),
+                            .pCommandBufferInfos = submission.commandBuffers.data(),
+                            .signalSemaphoreInfoCount = static_cast<uint32_t>(submission.signalSemaphores.size()),
+                            .pSignalSemaphoreInfos = submission.signalSemaphores.data()});
+    if (i + 1 == _submissionNumber || _submissions[i + 1].queueType != submission.queueType) {
+      vkQueueSubmit2(_device->getQueue(submission.queueType), _submitInfos.size(), _submitInfos.data(), nullptr);
+      _submitInfos.clear();
+    }
+  }
+  _submissionNumber = 0;
+}
 
-        if (pass->getGraphPassType() == GraphPassType::GRAPHIC) {
-          auto graphPassGraphic = static_cast<GraphPassGraphic*>(pass);
-          auto imageBarriers = calculateImageBarriers(graphPassGraphic->getTextureInputs(),
-                                                      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
-          vkCmdPipelineBarrier(commandBufferSubmit.back()->getCommandBuffer(),
-                               VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                               0, nullptr, 0, nullptr, imageBarriers.size(), imageBarriers.data());
-        }
+bool Graph::render() {
+  auto begin = std::chrono::steady_clock::now();
+  _beginFrame(1);
+  _timestamps->beginFrame(_frameInFlight, _valueSemaphoreInFlight);
+  if (_pipelineStatistics) _pipelineStatistics->beginFrame(_frameInFlight, _valueSemaphoreInFlight);
+  // run execution functions of passes that don't need swapchain image while presentation engine returns it
+  for (int i = 0; i < _passesOrdered.size(); i++)
+    if (_cache[_passesOrdered[i]].swapchainDependent == false) _recordPass(i, 0, true);
 
-        if (pass->getGraphPassType() == GraphPassType::COMPUTE) {
-          auto graphPassCompute = static_cast<GraphPassCompute*>(pass);
-          auto imageBarriers = calculateImageBarriers(graphPassCompute->getStorageTextureInputs(),
-                                                      VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
-          auto bufferBarriers = calculateBufferBarriers(graphPassCompute->getStorageBufferInputs(),
-                                                        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
-
-          vkCmdPipelineBarrier(previousPass->getCommandBuffers()[_frameInFlight]->getCommandBuffer(),
-                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
-                               nullptr, bufferBarriers.size(), bufferBarriers.data(), imageBarriers.size(),
-                               imageBarriers.data());
-        }
-      }
+  // submit recorded command buffer to GPU
+  auto submitPass = [this](int index, int swapchainIndex) {
+    // wait execution of current render pass
+    _waitPass(index);
+    _submitPass(_passesOrdered[index], swapchainIndex);
+  };
+  // passes before the one that waits for swapchain image don't depend on it, GPU starts them before acquire.
+  // Headless graph submits them with the last submission.
+  for (int i = 0; i < _indexAcquire; i++) submitPass(i, 0);
+  if (_swapchain) _flushSubmissions();
+
+  auto status = VK_SUCCESS;
+  if (_swapchain) {
+    TraceScope traceScope(_trace, "Acquire", _valueSemaphoreInFlight);
+    status = _swapchain->acquireNextImage(*_semaphoreImageAvailable[_frameInFlight]);
+  }
+  // notify about reset needed
+  if (status == VK_ERROR_OUT_OF_DATE_KHR) {
+    // frame is dropped, but reset and passes before acquire are already submitted: the rest of recorded command
+    // buffers is thrown away and semaphores signaled for them are consumed by empty submission that finishes frame
+    for (int i = 0; i < _passesOrdered.size(); i++) _waitPass(i);
+    std::set<VkSemaphore> signaled;
+    for (int i = 0; i < _indexAcquire; i++)
+      for (auto&& semaphore : _passesOrdered[i]->getSignalSemaphores()) signaled.insert(semaphore->getSemaphore());
+    auto& submission = _addSubmission(vkb::QueueType::graphics);
+    for (auto&& pass : _passesOrdered | std::views::drop(_indexAcquire)) {
+      auto commandBuffer = _getCommandBuffer(pass, 0);
+      if (commandBuffer->getActive()) commandBuffer->endCommands();
+      for (auto&& semaphore : pass->getWaitSemaphores())
+        if (signaled.contains(semaphore->getSemaphore()))
+          submission.waitSemaphores.push_back({.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                               .semaphore = semaphore->getSemaphore(),
+                                               .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT});
     }
-
-    commandBufferSubmit.push_back(pass->getCommandBuffers()[_frameInFlight]);
-    for (auto&& semaphore : pass->getSignalSemaphores()) signalSemaphores.push_back(semaphore->getSemaphore());
-    for (auto&& semaphore : pass->getWaitSemaphores()) waitSemaphores.push_back(semaphore->getSemaphore());
+    if (_semaphoreJoin.empty() == false && signaled.contains(_semaphoreJoin[_frameInFlight]->getSemaphore()))
+      submission.waitSemaphores.push_back({.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = _semaphoreJoin[_frameInFlight]->getSemaphore(),
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT});
+    submission.signalSemaphores.push_back({.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = _semaphoreInFlight->getSemaphore(),
+                                           .value = _valueSemaphoreInFlight,
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT});
+    _flushSubmissions();
+    // timestamps slice of the frame is reset when the frame in flight is used again, after timeline reaches the value
+    _timestamps->discardFrame();
+    if (_pipelineStatistics) _pipelineStatistics->discardFrame();
+
+    _valueSemaphoreInFlight++;
+    _frameInFlight = (_valueSemaphoreInFlight - 1) % _maxFramesInFlight;
+    return true;
+  } else if (status != VK_SUCCESS && status != VK_SUBOPTIMAL_KHR) {
+    throw std::runtime_error("failed to acquire swap chain image");
   }
 
-  // last pass changes swapchain layout if needed
-  if (_swapchain->getImage(swapchainIndex).getImageLayout() != VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) {
-    _swapchain->getImage(swapchainIndex)
-        .changeLayout(_swapchain->getImage(swapchainIndex).getImageLayout(), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-                      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_NONE, *commandBufferSubmit.back());
-  }
+  uint32_t swapchainIndex = _swapchain ? _swapchain->getSwapchainIndex() : 0;
+  for (int i = 0; i < _passesOrdered.size(); i++)
+    if (_cache[_passesOrdered[i]].swapchainDependent) _recordPass(i, swapchainIndex, true);
+  for (int i = _indexAcquire; i < _passesOrdered.size(); i++) submitPass(i, swapchainIndex);
 
-  // submit last pass
-  std::vector<uint64_t> signalValues(signalSemaphores.size() + 1, 0);
-  signalValues[signalSemaphores.size()] = _valueSemaphoreInFlight;
-  signalSemaphores.push_back(_semaphoreInFlight->getSemaphore());
-  VkTimelineSemaphoreSubmitInfo timelineSignalInfo = {.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
-                                                      .signalSemaphoreValueCount = (uint32_t)signalSemaphores.size(),
-                                                      .pSignalSemaphoreValues = signalValues.data()};
+  if (_swapchain) _swapchain->getImage(swapchainIndex).overrideLayout(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
-  submitPassToQueue(_passesOrdered.back(), commandBufferSubmit, waitSemaphores, signalSemaphores, timelineSignalInfo);
-  _timestamps->fetchTimestamps();
+  // submit last pass, timeline semaphore is signaled when both queues are finished
+  _submitFrameEnd(true);
+  _flushSubmissions();
+  _timestamps->endFrame();
+  if (_pipelineStatistics) _pipelineStatistics->endFrame();
+
+  _valueSemaphoreInFlight++;
+  _frameInFlight = (_valueSemaphoreInFlight - 1) % _maxFramesInFlight;
+  auto addFrameCPU = [this, begin]() {
+    _statistics->addFrameCPU(
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count());
+  };
+  // output of headless graph stays in graph storage
+  if (_swapchain == nullptr) {
+    addFrameCPU();
+    return false;
+  }
 
   auto semaphoreRenderFinished = _semaphoreRenderFinished[swapchainIndex]->getSemaphore();
   VkSwapchainKHR swapChains[] = {_swapchain->getSwapchain()};
@@ -736,11 +1783,10 @@ bool Graph::render() {
                                .swapchainCount = 1,
                                .pSwapchains = swapChains,
                                .pImageIndices = &swapchainIndex};
-
-  _valueSemaphoreInFlight++;
-  _frameInFlight = (_valueSemaphoreInFlight - 1) % _maxFramesInFlight;
-
+  // frame value is already advanced, present belongs to the previous one
+  TraceScope traceScope(_trace, "Present", _valueSemaphoreInFlight - 1);
   auto result = vkQueuePresentKHR(_device->getQueue(vkb::QueueType::present), &presentInfo);
+  addFrameCPU();
   if (result != VK_SUCCESS) {
     return true;
   }
@@ -748,20 +1794,79 @@ bool Graph::render() {
   return false;
 }
 
-void Graph::reset() {
-  // wait all queues idle before reset
-  if (vkDeviceWaitIdle(_device->getLogicalDevice()) != VK_SUCCESS) throw std::runtime_error("failed to reset");
+void Graph::renderBatch(int iterations) {
+  if (_swapchain) throw std::runtime_error("Batch can be rendered only by headless graph");
+  if (iterations < 1 || iterations > _framesInFlightLimit)
+    throw std::runtime_error("Batch can't have more iterations than frames in flight");
+
+  _beginFrame(iterations);
+  for (int iteration = 0; iteration < iterations; iteration++) {
+    // every iteration uses its own frame in flight, timestamps are kept for the last one
+    _timestamps->beginFrame(_frameInFlight, _valueSemaphoreInFlight);
+    if (_pipelineStatistics) _pipelineStatistics->beginFrame(_frameInFlight, _valueSemaphoreInFlight);
+    for (int i = 0; i < _passesOrdered.size(); i++) _recordPass(i, 0, iteration == iterations - 1);
+    for (int i = 0; i < _passesOrdered.size(); i++) {
+      _waitPass(i);
+      _submitPass(_passesOrdered[i], 0);
+    }
+    // only the last iteration signals timeline, it covers values of all previous ones
+    _submitFrameEnd(iteration == iterations - 1);
+    if (iteration < iterations - 1) {
+      _valueSemaphoreInFlight++;
+      _frameInFlight = (_valueSemaphoreInFlight - 1) % _maxFramesInFlight;
+    }
+  }
+  _flushSubmissions();
+  // the last iteration is the only measured one
+  _timestamps->endFrame();
+  if (_pipelineStatistics) _pipelineStatistics->endFrame();
+
+  _valueSemaphoreInFlight++;
+  _frameInFlight = (_valueSemaphoreInFlight - 1) % _maxFramesInFlight;
+}
 
+void Graph::reset() {
+  if (_swapchain == nullptr) throw std::runtime_error("Headless graph has no swapchain to reset");
   if (_window->getResolution().x == 0 || _window->getResolution().y == 0)
     throw std::runtime_error("Can't reset if resolution is 0");
 
+  // GPU isn't waited: frames in flight keep using old swapchain and images, they are destroyed after the last
+  // submitted frame is finished
+  uint64_t value = _valueSemaphoreInFlight - 1;
   auto oldSwapchain = _swapchain->reset(_window->getResolution());
+  // present mode and image count can be changed along with resolution
+  while (_semaphoreRenderFinished.size() < _swapchain->getImageCount())
+    _semaphoreRenderFinished.push_back(std::make_shared<Semaphore>(VK_SEMAPHORE_TYPE_BINARY, *_device));
+  auto destroySwapchain = [swapchain = _swapchain](void*) { swapchain->destroyRetired(); };
+  _device->destroyDeferred(std::shared_ptr<void>(nullptr, destroySwapchain), value);
+  // command buffer of the previous reset can still be pending
+  _device->destroyDeferred(std::move(_commandBuffersReset), value);
+  _commandBuffersReset = std::make_unique<CommandBuffer>(*_commandPoolReset, *_device);
   _commandBuffersReset->beginCommands();
-  _graphStorage->reset(oldSwapchain, _swapchain->getImageViews(), *_commandBuffersReset);
+  for (auto&& imageView : _graphStorage->reset(oldSwapchain, _swapchain->getImageViews(), *_commandBuffersReset))
+    _device->destroyDeferred(imageView, value);
+  for (auto&& imageView : oldSwapchain) _device->destroyDeferred(imageView, value);
+  // recreated images got their own memory, share it again
+  _alias(false);
+  // transient images that didn't get shared memory aren't transitioned at the first use
+  for (auto&& name : _graphStorage->getTransient()) {
+    auto handle = _graphStorage->getImageHandle(name);
+    if (handle.index < 0 || _graphStorage->getAliasedImages().contains(name)) continue;
+    for (auto&& imageView : _graphStorage->getImageViewHolder(handle).getImageViews())
+      imageView->getImage().changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE,
+                                         VK_ACCESS_NONE, *_commandBuffersReset);
+  }
+  // images are recreated, so rendering plans and barriers have to reference the new ones
+  _compileRendering();
+  _compileBarriers();
+  for (auto&& commandBuffer : _invalidateStatic()) _device->destroyDeferred(std::move(commandBuffer), value);
   for (auto&& pass : _passesOrdered) {
     pass->reset(_swapchain->getImageViews(), *_commandBuffersReset);
   }
+  _endCommandsReset();
+}
 
+void Graph::_endCommandsReset() {
   // insert global barrier so all image layout commands are being processed,
   // because we submit this command buffer to the same queue along the frame rendering command buffers
   VkMemoryBarrier mem{};
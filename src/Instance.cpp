@@ -14,7 +14,7 @@ VkBool32 debugCallbackUtils(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeveri
   return false;
 }
 
-Instance::Instance(std::string_view name, bool validation) {
+Instance::Instance(std::string_view name, bool validation, bool headless) {
   auto sts = volkInitialize();
   if (sts != VK_SUCCESS) throw std::runtime_error("Can't initialize Vulkan Loader");
   // VK_KHR_win32_surface || VK_KHR_android_surface as well as VK_KHR_surface
@@ -40,6 +40,7 @@ Instance::Instance(std::string_view name, bool validation) {
       _debugUtils = true;
     }
   }
+  builder.set_headless(headless);
   auto instanceResult = builder.set_app_name(name.data()).require_api_version(1, 3, 0).build();
   if (!instanceResult)
     throw std::runtime_error("Failed to create Vulkan instance. Error: " + instanceResult.error().message());
@@ -140,6 +140,15 @@ const VkPipeline& Pipeline::getPipeline() const noexcept { return _pipeline; }
 
 const VkPipelineLayout& Pipeline::getPipelineLayout() const noexcept { return _pipelineLayout; }
 
+const PipelineFeedback& Pipeline::getFeedback() const noexcept { return _feedback; }
+
+void Pipeline::_setFeedback(const VkPipelineCreationFeedback& feedback) noexcept {
+  _feedback.valid = feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT;
+  _feedback.cacheHit = _feedback.valid &&
+                       (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT);
+  _feedback.duration = std::chrono::nanoseconds(_feedback.valid ? feedback.duration : 0);
+}
+
 Pipeline::~Pipeline() {
   vkDestroyPipeline(_device->getLogicalDevice(), _pipeline, nullptr);
   vkDestroyPipelineLayout(_device->getLogicalDevice(), _pipelineLayout, nullptr);
@@ -182,6 +191,10 @@ void Pipeline::createGraphic(const PipelineGraphic& pipelineGraphic,
   renderingInfo.pColorAttachmentFormats = colorAttachments.data();
   auto depthAttachment = pipelineGraphic.getDepthAttachment();
   if (depthAttachment) renderingInfo.depthAttachmentFormat = depthAttachment.value();
+  VkPipelineCreationFeedback feedback{};
+  VkPipelineCreationFeedbackCreateInfo feedbackInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+                                                    .pPipelineCreationFeedback = &feedback};
+  renderingInfo.pNext = &feedbackInfo;
 
   auto colorBlendingState = pipelineGraphic.getColorBlending();
   std::vector blendAttachments(colorAttachments.size(), pipelineGraphic.getBlendAttachmentState());
@@ -206,11 +219,12 @@ void Pipeline::createGraphic(const PipelineGraphic& pipelineGraphic,
                                             .basePipelineHandle = nullptr};
   if (pipelineGraphic.getTessellationState())
     pipelineInfo.pTessellationState = &pipelineGraphic.getTessellationState().value();
-  auto status = vkCreateGraphicsPipelines(_device->getLogicalDevice(), nullptr, 1, &pipelineInfo, nullptr,
-                                          &_pipeline);
+  auto status = vkCreateGraphicsPipelines(_device->getLogicalDevice(), _device->getPipelineCache(), 1, &pipelineInfo,
+                                          nullptr, &_pipeline);
   if (status != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics pipeline!");
   }
+  _setFeedback(feedback);
 }
 
 void Pipeline::createCompute(const VkPipelineShaderStageCreateInfo& shaderStage,
@@ -242,13 +256,18 @@ void Pipeline::createCompute(const VkPipelineShaderStageCreateInfo& shaderStage,
     throw std::runtime_error("failed to create pipeline layout!");
   }
 
+  VkPipelineCreationFeedback feedback{};
+  VkPipelineCreationFeedbackCreateInfo feedbackInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+                                                    .pPipelineCreationFeedback = &feedback};
   VkComputePipelineCreateInfo computePipelineCreateInfo{};
   computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  computePipelineCreateInfo.pNext = &feedbackInfo;
   computePipelineCreateInfo.layout = _pipelineLayout;
   computePipelineCreateInfo.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
   //
   computePipelineCreateInfo.stage = shaderStage;
-  if (vkCreateComputePipelines(_device->getLogicalDevice(), nullptr, 1, &computePipelineCreateInfo, nullptr,
-                               &_pipeline) != VK_SUCCESS)
+  if (vkCreateComputePipelines(_device->getLogicalDevice(), _device->getPipelineCache(), 1, &computePipelineCreateInfo,
+                               nullptr, &_pipeline) != VK_SUCCESS)
     throw std::runtime_error("failed to create compute pipeline!");
+  _setFeedback(feedback);
 }
\ No newline at end of file
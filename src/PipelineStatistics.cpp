@@ -0,0 +1,165 @@
+module PipelineStatistics;
+import <algorithm>;
+import <stdexcept>;
+using namespace RenderGraph;
+
+namespace {
+// results are written in order of bits
+constexpr VkQueryPipelineStatisticFlags statisticsGraphics =
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+constexpr VkQueryPipelineStatisticFlags statisticsCompute = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+// values + availability
+constexpr int strideGraphics = 5;
+constexpr int strideCompute = 2;
+}  // namespace
+
+PipelineStatistics::PipelineStatistics(const Device& device) : _device(&device) {
+  if (_device->isPipelineStatistics() == false)
+    throw std::runtime_error("Device doesn't support pipeline statistics queries");
+}
+
+void PipelineStatistics::_destroyQueryPools() noexcept {
+  for (auto queryPool : {_queryPoolGraphics, _queryPoolCompute})
+    if (queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(_device->getLogicalDevice(), queryPool, nullptr);
+  _queryPoolGraphics = VK_NULL_HANDLE;
+  _queryPoolCompute = VK_NULL_HANDLE;
+}
+
+void PipelineStatistics::initialize(const std::vector<std::string>& passNames,
+                                    const std::vector<uint8_t>& passesCompute,
+                                    int framesInFlight) {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _destroyQueryPools();
+  _passNames = passNames;
+  _passesCompute = passesCompute;
+  _framesInFlight = framesInFlight;
+  _frameInFlight = 0;
+  _frames = std::make_unique<Frame[]>(framesInFlight);
+  for (int i = 0; i < framesInFlight; i++) _frames[i].passWritten.assign(passNames.size(), false);
+  _results.clear();
+  _resultsFrame = 0;
+  _queryResultsGraphics.resize(strideGraphics * passNames.size());
+  _queryResultsCompute.resize(strideCompute * passNames.size());
+  if (passNames.empty()) return;
+
+  // slice has a query for every pass in both pools, pass uses the one of its queue
+  auto createQueryPool = [&](VkQueryPipelineStatisticFlags statistics) {
+    VkQueryPoolCreateInfo createInfo{.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                                     .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+                                     .queryCount = static_cast<uint32_t>(passNames.size() * framesInFlight),
+                                     .pipelineStatistics = statistics};
+    VkQueryPool queryPool;
+    auto sts = vkCreateQueryPool(_device->getLogicalDevice(), &createInfo, nullptr, &queryPool);
+    if (sts != VK_SUCCESS) throw std::runtime_error("Failed to create pipeline statistics query pool");
+    vkResetQueryPool(_device->getLogicalDevice(), queryPool, 0, createInfo.queryCount);
+    return queryPool;
+  };
+  _queryPoolGraphics = createQueryPool(statisticsGraphics);
+  if (std::ranges::contains(passesCompute, true)) _queryPoolCompute = createQueryPool(statisticsCompute);
+}
+
+bool PipelineStatistics::_readFrame(int frameInFlight, bool force) {
+  auto& frame = _frames[frameInFlight];
+  if (std::ranges::contains(frame.passWritten, true) == false) {
+    frame.pending = false;
+    return true;
+  }
+
+  // not ready is expected: unmeasured passes never become available
+  int passNumber = _passNames.size();
+  auto read = [&](VkQueryPool queryPool, std::vector<uint64_t>& results, int stride) {
+    if (queryPool == VK_NULL_HANDLE) return true;
+    auto sts = vkGetQueryPoolResults(_device->getLogicalDevice(), queryPool, frameInFlight * passNumber, passNumber,
+                                     results.size() * sizeof(uint64_t), results.data(), stride * sizeof(uint64_t),
+                                     VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    return sts == VK_SUCCESS || sts == VK_NOT_READY;
+  };
+  if (read(_queryPoolGraphics, _queryResultsGraphics, strideGraphics) == false ||
+      read(_queryPoolCompute, _queryResultsCompute, strideCompute) == false) {
+    frame.pending = false;
+    return true;
+  }
+  auto available = [this](int index) {
+    if (_passesCompute[index]) return _queryResultsCompute[strideCompute * index + 1] != 0;
+    return _queryResultsGraphics[strideGraphics * index + 4] != 0;
+  };
+  if (force == false) {
+    for (int i = 0; i < passNumber; i++)
+      if (frame.passWritten[i] && available(i) == false) return false;
+  }
+
+  // entries are kept between frames, so steady state doesn't allocate
+  for (int i = 0; i < passNumber; i++) {
+    if (frame.passWritten[i] == false || available(i) == false) continue;
+    auto result = _results.find(_passNames[i]);
+    if (result == _results.end()) result = _results.emplace(_passNames[i], PassStatistics{}).first;
+    if (_passesCompute[i]) {
+      result->second = {.computeInvocations = _queryResultsCompute[strideCompute * i]};
+    } else {
+      auto values = &_queryResultsGraphics[strideGraphics * i];
+      result->second = {.vertexInvocations = values[0],
+                        .clippingPrimitives = values[1],
+                        .fragmentInvocations = values[2],
+                        .computeInvocations = values[3]};
+    }
+  }
+  _resultsFrame = frame.frameNumber;
+  frame.pending = false;
+  return true;
+}
+
+void PipelineStatistics::_poll() {
+  for (int i = 0; i < _framesInFlight; i++) {
+    int oldest = -1;
+    for (int j = 0; j < _framesInFlight; j++)
+      if (_frames[j].pending && (oldest < 0 || _frames[j].frameNumber < _frames[oldest].frameNumber)) oldest = j;
+    if (oldest < 0 || _readFrame(oldest, false) == false) return;
+  }
+}
+
+void PipelineStatistics::beginFrame(int frameInFlight, uint64_t frameNumber) {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _poll();
+  auto& frame = _frames[frameInFlight];
+  if (frame.pending) _readFrame(frameInFlight, true);
+  int passNumber = _passNames.size();
+  for (auto queryPool : {_queryPoolGraphics, _queryPoolCompute})
+    if (queryPool != VK_NULL_HANDLE)
+      vkResetQueryPool(_device->getLogicalDevice(), queryPool, frameInFlight * passNumber, passNumber);
+  std::ranges::fill(frame.passWritten, false);
+  frame.frameNumber = frameNumber;
+  _frameInFlight = frameInFlight;
+}
+
+void PipelineStatistics::endFrame() {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _frames[_frameInFlight].pending = true;
+  _poll();
+}
+
+void PipelineStatistics::discardFrame() {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _frames[_frameInFlight].pending = false;
+}
+
+void PipelineStatistics::beginPass(int index, const CommandBuffer& commandBuffer) noexcept {
+  auto queryPool = _passesCompute[index] ? _queryPoolCompute : _queryPoolGraphics;
+  vkCmdBeginQuery(commandBuffer.getCommandBuffer(), queryPool, _frameInFlight * _passNames.size() + index, 0);
+  _frames[_frameInFlight].passWritten[index] = true;
+}
+
+void PipelineStatistics::endPass(int index, const CommandBuffer& commandBuffer) noexcept {
+  auto queryPool = _passesCompute[index] ? _queryPoolCompute : _queryPoolGraphics;
+  vkCmdEndQuery(commandBuffer.getCommandBuffer(), queryPool, _frameInFlight * _passNames.size() + index);
+}
+
+std::map<std::string, PassStatistics> PipelineStatistics::getPipelineStatistics(uint64_t* frame) {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _poll();
+  if (frame) *frame = _resultsFrame;
+  return {_results.begin(), _results.end()};
+}
+
+PipelineStatistics::~PipelineStatistics() { _destroyQueryPools(); }
\ No newline at end of file
@@ -0,0 +1,97 @@
+module Statistics;
+import <algorithm>;
+import <cmath>;
+import <numeric>;
+import <stdexcept>;
+using namespace RenderGraph;
+
+RollingStatistics::RollingStatistics(int window) : _samples(window), _scratch(window) {
+  if (window < 1) throw std::runtime_error("Statistics window has to have at least one sample");
+}
+
+void RollingStatistics::add(double value) noexcept {
+  _samples[_index] = value;
+  _index = (_index + 1) % _samples.size();
+  _number = std::min<int>(_number + 1, _samples.size());
+}
+
+Percentiles RollingStatistics::get() const noexcept {
+  Percentiles percentiles{.samples = _number};
+  if (_number == 0) return percentiles;
+  // until the ring is full samples are at its beginning
+  auto begin = _scratch.begin(), end = _scratch.begin() + _number;
+  std::copy_n(_samples.begin(), _number, begin);
+  percentiles.mean = std::accumulate(begin, end, 0.0) / _number;
+  percentiles.max = *std::max_element(begin, end);
+  // nearest rank, every nth_element leaves bigger samples after the rank, so the next one searches only there
+  auto nth = begin;
+  auto rank = [&](double percentile) {
+    auto next = begin + std::max(0, static_cast<int>(std::ceil(percentile * _number)) - 1);
+    std::nth_element(nth, next, end);
+    nth = next;
+    return *next;
+  };
+  percentiles.p50 = rank(0.50);
+  percentiles.p95 = rank(0.95);
+  percentiles.p99 = rank(0.99);
+  return percentiles;
+}
+
+int FrameStatistics::_findPass(std::string_view name) const noexcept {
+  auto pass = std::ranges::find(_passNames, name);
+  if (pass == _passNames.end()) return -1;
+  return pass - _passNames.begin();
+}
+
+void FrameStatistics::initialize(const std::vector<std::string>& passNames, int window) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _passNames = passNames;
+  _passesGPU.assign(passNames.size(), RollingStatistics(window));
+  _passesCPU.assign(passNames.size(), RollingStatistics(window));
+  _frameGPU = RollingStatistics(window);
+  _frameCPU = RollingStatistics(window);
+}
+
+void FrameStatistics::addPassGPU(int index, double duration) noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _passesGPU[index].add(duration);
+}
+
+void FrameStatistics::addPassCPU(int index, double duration) noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _passesCPU[index].add(duration);
+}
+
+void FrameStatistics::addFrameGPU(double duration) noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _frameGPU.add(duration);
+}
+
+void FrameStatistics::addFrameCPU(double duration) noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _frameCPU.add(duration);
+}
+
+Percentiles FrameStatistics::getPassGPU(std::string_view name) const noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  int index = _findPass(name);
+  if (index < 0) return {};
+  return _passesGPU[index].get();
+}
+
+Percentiles FrameStatistics::getPassCPU(std::string_view name) const noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  int index = _findPass(name);
+  if (index < 0) return {};
+  return _passesCPU[index].get();
+}
+
+Percentiles FrameStatistics::getFrameGPU() const noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _frameGPU.get();
+}
+
+Percentiles FrameStatistics::getFrameCPU() const noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _frameCPU.get();
+}
\ No newline at end of file
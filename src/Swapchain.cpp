@@ -4,28 +4,35 @@ import <ranges>;
 import <iostream>;
 using namespace RenderGraph;
 
-Swapchain::Swapchain(glm::ivec2 resolution, const MemoryAllocator& allocator, const Device& device)
+Swapchain::Swapchain(glm::ivec2 resolution,
+                     const MemoryAllocator& allocator,
+                     const Device& device,
+                     VkPresentModeKHR presentMode,
+                     int minImageCount)
     : _allocator(&allocator),
-      _device(&device) {
-  vkb::SwapchainBuilder builder{device.getDevice()};
+      _device(&device),
+      _presentMode(presentMode),
+      _minImageCount(minImageCount) {
+  auto swapchainResult = _getBuilder(resolution).build();
+  if (!swapchainResult) {
+    throw std::runtime_error(swapchainResult.error().message());
+  }
+  // TODO: check extent
+  _swapchain = swapchainResult.value();
+}
+
+vkb::SwapchainBuilder Swapchain::_getBuilder(glm::ivec2 resolution) const noexcept {
+  vkb::SwapchainBuilder builder{_device->getDevice()};
   builder.set_desired_extent(static_cast<uint32_t>(resolution.x), static_cast<uint32_t>(resolution.y));
   builder.set_composite_alpha_flags(VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR);
   builder.set_desired_format(
       VkSurfaceFormatKHR{.format = _swapchainFormat, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR});
   // because we use swapchain in compute shader
   builder.add_image_usage_flags(VK_IMAGE_USAGE_STORAGE_BIT);
-  if (_verticalSync) {
-    builder.set_desired_present_mode(VK_PRESENT_MODE_MAILBOX_KHR);
-  } else {
-    builder.set_desired_present_mode(VK_PRESENT_MODE_IMMEDIATE_KHR);
-  }
-
-  auto swapchainResult = builder.build();
-  if (!swapchainResult) {
-    throw std::runtime_error(swapchainResult.error().message());
-  }
-  // TODO: check extent
-  _swapchain = swapchainResult.value();
+  // FIFO is the fallback, it's always supported
+  builder.set_desired_present_mode(_presentMode);
+  if (_minImageCount > 0) builder.set_desired_min_image_count(static_cast<uint32_t>(_minImageCount));
+  return builder;
 }
 
 void Swapchain::initialize() {
@@ -54,9 +61,24 @@ Swapchain::~Swapchain() { _destroy(); }
 void Swapchain::_destroy() {
   _imageViews.clear();
   _imageViews.shrink_to_fit();
+  while (_swapchainsRetired.empty() == false) destroyRetired();
   vkb::destroy_swapchain(_swapchain);
 }
 
+void Swapchain::destroyRetired() noexcept {
+  if (_swapchainsRetired.empty()) return;
+  vkb::destroy_swapchain(_swapchainsRetired.front());
+  _swapchainsRetired.pop_front();
+}
+
+int Swapchain::getRetiredCount() const noexcept { return _swapchainsRetired.size(); }
+
+void Swapchain::setPresentMode(VkPresentModeKHR presentMode) noexcept { _presentMode = presentMode; }
+
+void Swapchain::setMinImageCount(int minImageCount) noexcept { _minImageCount = minImageCount; }
+
+VkPresentModeKHR Swapchain::getPresentMode() const noexcept { return _swapchain.present_mode; }
+
 Image& Swapchain::getImage(int index) const noexcept { return _imageViews[index]->getImage(); }
 
 std::vector<std::shared_ptr<ImageView>> Swapchain::getImageViews() const noexcept { return _imageViews; };
@@ -68,14 +90,8 @@ const vkb::Swapchain& Swapchain::getSwapchain() const noexcept { return _swapcha
 uint32_t Swapchain::getSwapchainIndex() const noexcept { return _swapchainIndex; }
 
 std::vector<std::shared_ptr<ImageView>> Swapchain::reset(glm::ivec2 resolution) {
-  vkb::SwapchainBuilder builder{_device->getDevice()};
-  builder.set_desired_extent(static_cast<uint32_t>(resolution.x), static_cast<uint32_t>(resolution.y));
+  auto builder = _getBuilder(resolution);
   builder.set_old_swapchain(_swapchain);
-  builder.set_composite_alpha_flags(VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR);
-  builder.set_desired_format(
-      VkSurfaceFormatKHR{.format = _swapchainFormat, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR});
-  // because we use swapchain in compute shader
-  builder.add_image_usage_flags(VK_IMAGE_USAGE_STORAGE_BIT);
   auto swapchainResult = builder.build();
   if (!swapchainResult) {
     // If it failed to create a swapchain, the old swapchain handle is invalid.
@@ -83,8 +99,9 @@ std::vector<std::shared_ptr<ImageView>> Swapchain::reset(glm::ivec2 resolution)
   }
   auto imageViewsOld = _imageViews;
 
-  // Even though we recycled the previous swapchain, we need to free its resources.
-  _destroy();
+  // previous swapchain is recycled, but its images can still be used by frames in flight
+  _imageViews.clear();
+  _swapchainsRetired.push_back(_swapchain);
   // Get the new swapchain and place it in our variable
   _swapchain = swapchainResult.value();
 
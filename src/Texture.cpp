@@ -9,6 +9,24 @@ using namespace RenderGraph;
 
 Image::Image(const MemoryAllocator& memoryAllocator) : _memoryAllocator(&memoryAllocator) {}
 
+VkImageCreateInfo Image::_getImageCreateInfo() const noexcept {
+  return VkImageCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .imageType = VK_IMAGE_TYPE_2D,
+      .format = _format,
+      .extent = {.width = static_cast<uint32_t>(_resolution.x),
+                 .height = static_cast<uint32_t>(_resolution.y),
+                 .depth = 1},
+      .mipLevels = static_cast<uint32_t>(_mipMapNumber),
+      .arrayLayers = static_cast<uint32_t>(_layerNumber),
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      .usage = _usageFlags,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+  };
+}
+
 void Image::createImage(VkFormat format,
                         glm::ivec2 resolution,
                         int mipMapNumber,
@@ -22,22 +40,7 @@ void Image::createImage(VkFormat format,
   _aspectMask = aspectMask;
   _usageFlags = usage;
 
-  VkImageCreateInfo imageInfo{
-      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-      .imageType = VK_IMAGE_TYPE_2D,
-      .format = format,
-      .extent = {.width = static_cast<uint32_t>(resolution.x),
-                 .height = static_cast<uint32_t>(resolution.y),
-                 .depth = 1},
-      .mipLevels = static_cast<uint32_t>(mipMapNumber),
-      .arrayLayers = static_cast<uint32_t>(layerNumber),
-      .samples = VK_SAMPLE_COUNT_1_BIT,
-      .tiling = VK_IMAGE_TILING_OPTIMAL,
-      .usage = usage,
-      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-  };
-
+  VkImageCreateInfo imageInfo = _getImageCreateInfo();
   VmaAllocationCreateInfo allocCreateInfo = {};
   allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
 
@@ -46,6 +49,25 @@ void Image::createImage(VkFormat format,
   if (sts != VK_SUCCESS) throw std::invalid_argument("Can't create an image " + sts);
 }
 
+void Image::createAliasingImage(std::shared_ptr<MemoryAllocation> memoryAllocation) {
+  destroy();
+
+  VkImageCreateInfo imageInfo = _getImageCreateInfo();
+  auto sts = vmaCreateAliasingImage(_memoryAllocator->getAllocator(), memoryAllocation->getAllocation(), &imageInfo,
+                                    &_image);
+  if (sts != VK_SUCCESS) throw std::invalid_argument("Can't create an aliasing image");
+  _memoryAliasing = memoryAllocation;
+  _imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+void Image::createOwnImage() {
+  destroy();
+  createImage(_format, _resolution, _mipMapNumber, _layerNumber, _aspectMask, _usageFlags);
+  _imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+bool Image::isAliased() const noexcept { return _memoryAliasing != nullptr; }
+
 void Image::wrapImage(const VkImage& existingImage,
                       VkFormat format,
                       glm::ivec2 resolution,
@@ -100,14 +122,48 @@ VkImageAspectFlags Image::getAspectMask() const noexcept { return _aspectMask; }
 
 VkImageUsageFlags Image::getUsageFlags() const noexcept { return _usageFlags; }
 
+VkMemoryRequirements Image::getMemoryRequirements(const Device& device) const noexcept {
+  VkMemoryRequirements memoryRequirements;
+  vkGetImageMemoryRequirements(device.getLogicalDevice(), _image, &memoryRequirements);
+  return memoryRequirements;
+}
+
+const MemoryAllocator& Image::getMemoryAllocator() const noexcept { return *_memoryAllocator; }
+
 void Image::changeLayout(VkImageLayout oldLayout,
                          VkImageLayout newLayout,
                          VkAccessFlags srcAccessMask,
                          VkAccessFlags dstAccessMask,
                          const CommandBuffer& commandBuffer) {
+  changeLayout(oldLayout, newLayout, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, srcAccessMask,
+               VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, dstAccessMask, commandBuffer);
+}
+
+void Image::changeLayout(VkImageLayout oldLayout,
+                         VkImageLayout newLayout,
+                         VkPipelineStageFlags2 srcStageMask,
+                         VkAccessFlags2 srcAccessMask,
+                         VkPipelineStageFlags2 dstStageMask,
+                         VkAccessFlags2 dstAccessMask,
+                         const CommandBuffer& commandBuffer) {
   _imageLayout = newLayout;
-  VkImageMemoryBarrier barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+  auto barrier = getBarrier(oldLayout, newLayout, srcStageMask, srcAccessMask, dstStageMask, dstAccessMask);
+  VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                  .imageMemoryBarrierCount = 1,
+                                  .pImageMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer.getCommandBuffer(), &dependencyInfo);
+}
+
+VkImageMemoryBarrier2 Image::getBarrier(VkImageLayout oldLayout,
+                                        VkImageLayout newLayout,
+                                        VkPipelineStageFlags2 srcStageMask,
+                                        VkAccessFlags2 srcAccessMask,
+                                        VkPipelineStageFlags2 dstStageMask,
+                                        VkAccessFlags2 dstAccessMask) const noexcept {
+  return VkImageMemoryBarrier2{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                               .srcStageMask = srcStageMask,
                                .srcAccessMask = srcAccessMask,
+                               .dstStageMask = dstStageMask,
                                .dstAccessMask = dstAccessMask,
                                .oldLayout = oldLayout,
                                .newLayout = newLayout,
@@ -119,9 +175,6 @@ void Image::changeLayout(VkImageLayout oldLayout,
                                                     .levelCount = static_cast<uint32_t>(_mipMapNumber),
                                                     .baseArrayLayer = 0,
                                                     .layerCount = static_cast<uint32_t>(_layerNumber)}};
-
-  vkCmdPipelineBarrier(commandBuffer.getCommandBuffer(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
 void Image::overrideLayout(VkImageLayout layout) { _imageLayout = layout; }
@@ -209,6 +262,11 @@ int Image::getLayerNumber() const noexcept { return _layerNumber; }
 void Image::destroy() {
   if (_imageMemory) {
     vmaDestroyImage(_memoryAllocator->getAllocator(), _image, _imageMemory);
+    _imageMemory = nullptr;
+  } else if (_memoryAliasing) {
+    // memory is owned by MemoryAllocation, destroy only image itself
+    vmaDestroyImage(_memoryAllocator->getAllocator(), _image, nullptr);
+    _memoryAliasing = nullptr;
   }
 }
 
@@ -255,6 +313,8 @@ int ImageView::getBaseMipMap() const noexcept { return _baseMipMap; }
 
 int ImageView::getBaseArrayLayer() const noexcept { return _baseArrayLayer; }
 
+const Device& ImageView::getDevice() const noexcept { return *_device; }
+
 void ImageView::destroy() { vkDestroyImageView(_device->getLogicalDevice(), _imageView, nullptr); }
 
 ImageView::~ImageView() { destroy(); }
@@ -267,6 +327,11 @@ ImageViewHolder::ImageViewHolder(std::vector<std::shared_ptr<ImageView>> imageVi
 
 void ImageViewHolder::setImageViews(std::vector<std::shared_ptr<ImageView>> imageViews) { _imageViews = imageViews; }
 
+std::shared_ptr<ImageView> ImageViewHolder::setImageView(int index, std::shared_ptr<ImageView> imageView) {
+  std::swap(_imageViews[index], imageView);
+  return imageView;
+}
+
 const ImageView& ImageViewHolder::getImageView() const noexcept { return *_imageViews[_index()]; }
 
 std::function<int()> ImageViewHolder::getIndexFunction() const noexcept { return _index; }
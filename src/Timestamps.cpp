@@ -1,6 +1,40 @@
+module;
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
 module Timestamps;
+import <algorithm>;
+import <array>;
+import <chrono>;
+import <limits>;
 using namespace RenderGraph;
 
+namespace {
+// time domain steady clock is read from
+#ifdef _WIN32
+constexpr VkTimeDomainEXT timeDomainHost = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+constexpr VkTimeDomainEXT timeDomainHost = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+// number of calibrations, the one with the smallest deviation is used
+constexpr int calibrationSamples = 4;
+
+// host timestamp in steady clock ns
+int64_t toSteadyClock(uint64_t timestamp) {
+#ifdef _WIN32
+  // performance counter ticks, split so conversion doesn't overflow
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  int64_t ticks = timestamp;
+  return ticks / frequency.QuadPart * 1'000'000'000 + ticks % frequency.QuadPart * 1'000'000'000 / frequency.QuadPart;
+#else
+  return timestamp;
+#endif
+}
+}  // namespace
+
 Timestamps::Timestamps(const Device& device) : _device(&device) {
   if (_device->getQueueFamilyProperties(vkb::QueueType::graphics).timestampValidBits == 0)
     throw std::runtime_error("Graphics queue doesn't support timestamps");
@@ -8,58 +42,226 @@ Timestamps::Timestamps(const Device& device) : _device(&device) {
     throw std::runtime_error("Compute queue doesn't support timestamps");
 
   _timestampPeriod = _device->getDeviceProperties().limits.timestampPeriod;
+}
+
+void Timestamps::_destroyQueryPool() noexcept {
+  if (_queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(_device->getLogicalDevice(), _queryPool, nullptr);
+  _queryPool = VK_NULL_HANDLE;
+}
+
+void Timestamps::initialize(const std::vector<std::string>& passNames,
+                            const std::vector<std::string>& passTracks,
+                            int scopeNumber,
+                            int framesInFlight) {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _destroyQueryPool();
+  _passNames = passNames;
+  _passTracks = passTracks;
+  _framesInFlight = framesInFlight;
+  _frameInFlight = 0;
+  _frames = std::make_unique<Frame[]>(framesInFlight);
+  for (int i = 0; i < framesInFlight; i++) {
+    _frames[i].passWritten.assign(passNames.size(), false);
+    _frames[i].scopes.assign(scopeNumber, Scope{});
+  }
+  _timestampResults.clear();
+  _resultsFrame = 0;
+
+  _querySliceNumber = 2 * (passNames.size() + scopeNumber);
+  _queryResults.resize(2 * _querySliceNumber);
+  if (_querySliceNumber == 0) return;
+
   VkQueryPoolCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
   createInfo.flags = 0;
   createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
-  createInfo.queryCount = _queryMaxNumber;
+  createInfo.queryCount = _querySliceNumber * framesInFlight;
 
   auto sts = vkCreateQueryPool(_device->getLogicalDevice(), &createInfo, nullptr, &_queryPool);
   if (sts != VK_SUCCESS) throw std::runtime_error("Failed to create timestamps query pool");
+  // slice is reset before its frame is recorded, but a pending frame reads it back before that
+  vkResetQueryPool(_device->getLogicalDevice(), _queryPool, 0, createInfo.queryCount);
 }
 
-void Timestamps::resetQueryPool() noexcept {
-  vkResetQueryPool(_device->getLogicalDevice(), _queryPool, 0, _queryMaxNumber);
+void Timestamps::setTrace(Trace* trace) {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _trace = trace;
 }
 
-void Timestamps::pushTimestamp(std::string_view name, const CommandBuffer& commandBuffer) {
-  std::unique_lock<std::mutex> lock(_mutexPush);
-  int currentIndex = _timestampIndex;
-  vkCmdWriteTimestamp(commandBuffer.getCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, currentIndex);
-  _timestampRanges[std::string(name)].x = currentIndex;
-  _timestampIndex++;
+void Timestamps::setStatistics(FrameStatistics* statistics) {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _statistics = statistics;
 }
 
-void Timestamps::popTimestamp(std::string_view name, const CommandBuffer& commandBuffer) {
-  std::unique_lock<std::mutex> lock(_mutexPush);
-  int currentIndex = _timestampIndex;
-  vkCmdWriteTimestamp(commandBuffer.getCommandBuffer(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, currentIndex);
-  _timestampRanges.at(std::string(name)).y = currentIndex;
-  _timestampIndex++;
+std::optional<int64_t> Timestamps::getCalibration() const {
+  if (_device->isCalibratedTimestamps() == false) return std::nullopt;
+  std::array<VkCalibratedTimestampInfoEXT, 2> timestampInfos{
+      VkCalibratedTimestampInfoEXT{.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+                                   .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT},
+      VkCalibratedTimestampInfoEXT{.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+                                   .timeDomain = timeDomainHost}};
+  // driver samples device and host domains together, otherwise host time is taken in the middle of the call
+  bool sampledHost = std::ranges::contains(_device->getTimeDomains(), timeDomainHost);
+  std::optional<int64_t> calibration;
+  uint64_t deviationMin = std::numeric_limits<uint64_t>::max();
+  // deviation grows if thread is preempted during the call
+  for (int i = 0; i < calibrationSamples; i++) {
+    std::array<uint64_t, 2> timestamps{};
+    uint64_t deviation = 0;
+    int64_t host = 0;
+    if (sampledHost) {
+      if (vkGetCalibratedTimestampsEXT(_device->getLogicalDevice(), timestampInfos.size(), timestampInfos.data(),
+                                       timestamps.data(), &deviation) != VK_SUCCESS)
+        return std::nullopt;
+      host = toSteadyClock(timestamps[1]);
+    } else {
+      auto begin = std::chrono::steady_clock::now();
+      if (vkGetCalibratedTimestampsEXT(_device->getLogicalDevice(), 1, timestampInfos.data(), timestamps.data(),
+                                       &deviation) != VK_SUCCESS)
+        return std::nullopt;
+      auto end = std::chrono::steady_clock::now();
+      deviation = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+      host = std::chrono::duration_cast<std::chrono::nanoseconds>((begin + (end - begin) / 2).time_since_epoch())
+                 .count();
+    }
+    if (deviation < deviationMin) {
+      deviationMin = deviation;
+      calibration = host - static_cast<int64_t>(timestamps[0] * _timestampPeriod);
+    }
+  }
+  return calibration;
 }
 
-void Timestamps::fetchTimestamps() {
-  if (_timestampIndex >= _queryMaxNumber) throw std::runtime_error("More timestamps requested than allocated");
-  std::unique_lock<std::mutex> lock(_mutexRequest);
-  _timestampResults.clear();
+void Timestamps::_setResult(std::string_view name, int query) {
+  auto result = _timestampResults.find(name);
+  if (result == _timestampResults.end())
+    result = _timestampResults.emplace(name, std::pair{glm::dvec2(), _readNumber}).first;
+  result->second = {{_queryResults[2 * query] * _timestampPeriod, _queryResults[2 * (query + 1)] * _timestampPeriod},
+                    _readNumber};
+}
 
-  std::vector<uint64_t> buffer(_timestampIndex);
-  auto sts = vkGetQueryPoolResults(_device->getLogicalDevice(), _queryPool, 0, _timestampIndex,
-                                   buffer.size() * sizeof(uint64_t), buffer.data(), sizeof(uint64_t),
-                                   VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
-  if (sts == VK_SUCCESS) {
-    for (auto [key, value] : _timestampRanges) {
-      _timestampResults[key] = {buffer[value.x] * _timestampPeriod, buffer[value.y] * _timestampPeriod};
-    }
+bool Timestamps::_readFrame(int frameInFlight, bool force) {
+  auto& frame = _frames[frameInFlight];
+  int passNumber = _passNames.size();
+  int scopeNumber = std::min<int>(frame.scopeIndex, frame.scopes.size());
+  // unmeasured frame, for example not the last iteration of batch, keeps the previous results
+  if (std::ranges::contains(frame.passWritten, true) == false && scopeNumber == 0) {
+    frame.pending = false;
+    return true;
+  }
+
+  // not ready is expected: unmeasured passes never become available
+  int count = 2 * (passNumber + scopeNumber);
+  auto sts = vkGetQueryPoolResults(_device->getLogicalDevice(), _queryPool, frameInFlight * _querySliceNumber, count,
+                                   2 * count * sizeof(uint64_t), _queryResults.data(), 2 * sizeof(uint64_t),
+                                   VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+  if (sts != VK_SUCCESS && sts != VK_NOT_READY) {
+    frame.pending = false;
+    return true;
   }
+  auto available = [this](int query) { return _queryResults[2 * query + 1] != 0 && _queryResults[2 * query + 3] != 0; };
+  if (force == false) {
+    for (int i = 0; i < passNumber; i++)
+      if (frame.passWritten[i] && available(2 * i) == false) return false;
+    for (int i = 0; i < scopeNumber; i++)
+      if (available(2 * (passNumber + i)) == false) return false;
+  }
+
+  _readNumber++;
+  auto addSpan = [&](std::string_view name, std::string_view track, int query) {
+    _setResult(name, query);
+    if (_trace)
+      _trace->addSpanGPU(name, track, _queryResults[2 * query] * _timestampPeriod,
+                         _queryResults[2 * (query + 1)] * _timestampPeriod, frame.frameNumber);
+  };
+  // frame on GPU lasts from the first pass start to the last pass end on any queue
+  glm::dvec2 frameSpan(std::numeric_limits<double>::max(), 0);
+  for (int i = 0; i < passNumber; i++) {
+    if (frame.passWritten[i] == false || available(2 * i) == false) continue;
+    addSpan(_passNames[i], _passTracks[i], 2 * i);
+    glm::dvec2 span = glm::dvec2(_queryResults[4 * i], _queryResults[4 * i + 2]) * _timestampPeriod;
+    frameSpan = {std::min(frameSpan.x, span.x), std::max(frameSpan.y, span.y)};
+    if (_statistics) _statistics->addPassGPU(i, span.y - span.x);
+  }
+  if (_statistics && frameSpan.y >= frameSpan.x) _statistics->addFrameGPU(frameSpan.y - frameSpan.x);
+  // element scopes can be recorded on any queue
+  for (int i = 0; i < scopeNumber; i++) {
+    int query = frame.scopes[i].query - frameInFlight * _querySliceNumber;
+    if (available(query)) addSpan(frame.scopes[i].name, "Elements", query);
+  }
+  std::erase_if(_timestampResults, [this](auto& result) { return result.second.second != _readNumber; });
+  _resultsFrame = frame.frameNumber;
+  frame.pending = false;
+  return true;
+}
+
+void Timestamps::_poll() {
+  for (int i = 0; i < _framesInFlight; i++) {
+    int oldest = -1;
+    for (int j = 0; j < _framesInFlight; j++)
+      if (_frames[j].pending && (oldest < 0 || _frames[j].frameNumber < _frames[oldest].frameNumber)) oldest = j;
+    if (oldest < 0 || _readFrame(oldest, false) == false) return;
+  }
+}
+
+void Timestamps::beginFrame(int frameInFlight, uint64_t frameNumber) {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _poll();
+  auto& frame = _frames[frameInFlight];
+  if (frame.pending) _readFrame(frameInFlight, true);
+  if (_queryPool != VK_NULL_HANDLE)
+    vkResetQueryPool(_device->getLogicalDevice(), _queryPool, frameInFlight * _querySliceNumber, _querySliceNumber);
+  std::ranges::fill(frame.passWritten, false);
+  frame.scopeIndex = 0;
+  frame.frameNumber = frameNumber;
+  _frameInFlight = frameInFlight;
+}
+
+void Timestamps::endFrame() {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _frames[_frameInFlight].pending = true;
+  _poll();
+}
+
+void Timestamps::discardFrame() {
+  std::unique_lock<std::mutex> lock(_mutexRequest);
+  _frames[_frameInFlight].pending = false;
+}
+
+void Timestamps::beginPass(int index, const CommandBuffer& commandBuffer) noexcept {
+  vkCmdWriteTimestamp(commandBuffer.getCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool,
+                      _frameInFlight * _querySliceNumber + 2 * index);
+  _frames[_frameInFlight].passWritten[index] = true;
+}
+
+void Timestamps::endPass(int index, const CommandBuffer& commandBuffer) noexcept {
+  vkCmdWriteTimestamp(commandBuffer.getCommandBuffer(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool,
+                      _frameInFlight * _querySliceNumber + 2 * index + 1);
+}
+
+int Timestamps::beginScope(std::string_view name, const CommandBuffer& commandBuffer) noexcept {
+  auto& frame = _frames[_frameInFlight];
+  int scope = frame.scopeIndex.fetch_add(1, std::memory_order_relaxed);
+  if (scope >= frame.scopes.size()) return -1;
+  int query = _frameInFlight * _querySliceNumber + 2 * (_passNames.size() + scope);
+  frame.scopes[scope] = {.name = name, .query = query};
+  vkCmdWriteTimestamp(commandBuffer.getCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, query);
+  return scope;
+}
 
-  _timestampIndex = 0;
-  _timestampRanges.clear();
+void Timestamps::endScope(int scope, const CommandBuffer& commandBuffer) noexcept {
+  if (scope < 0) return;
+  vkCmdWriteTimestamp(commandBuffer.getCommandBuffer(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool,
+                      _frames[_frameInFlight].scopes[scope].query + 1);
 }
 
-std::map<std::string, glm::dvec2> Timestamps::getTimestamps() {
+std::map<std::string, glm::dvec2> Timestamps::getTimestamps(uint64_t* frame) {
   std::unique_lock<std::mutex> lock(_mutexRequest);
-  return _timestampResults;
+  _poll();
+  if (frame) *frame = _resultsFrame;
+  std::map<std::string, glm::dvec2> timestamps;
+  for (auto&& [key, value] : _timestampResults) timestamps.emplace(key, value.first);
+  return timestamps;
 }
 
-Timestamps::~Timestamps() { vkDestroyQueryPool(_device->getLogicalDevice(), _queryPool, nullptr); }
\ No newline at end of file
+Timestamps::~Timestamps() { _destroyQueryPool(); }
\ No newline at end of file
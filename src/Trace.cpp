@@ -0,0 +1,149 @@
+module Trace;
+import <algorithm>;
+import <format>;
+import <fstream>;
+import <limits>;
+import <stdexcept>;
+import <vector>;
+using namespace RenderGraph;
+
+Trace::Trace(int frameNumber) {
+  if (frameNumber < 1) throw std::runtime_error("Trace has to keep at least one frame");
+  _frameNumber = frameNumber;
+}
+
+void Trace::_addSpan(Span span) {
+  // GPU spans are read back later than CPU spans of the same frame, so window is moved by the newest frame
+  if (span.frame > _frameLast) {
+    _frameLast = span.frame;
+    if (_frameLast > _frameNumber) {
+      uint64_t frameFirst = _frameLast - _frameNumber + 1;
+      std::erase_if(_spans, [frameFirst](const Span& span) { return span.frame < frameFirst; });
+    }
+  }
+  if (_frameLast >= _frameNumber && span.frame <= _frameLast - _frameNumber) return;
+  _spans.push_back(std::move(span));
+}
+
+void Trace::addSpanCPU(std::string_view name,
+                       std::chrono::steady_clock::time_point begin,
+                       std::chrono::steady_clock::time_point end,
+                       uint64_t frame) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  auto thread = _threads.try_emplace(std::this_thread::get_id(), _threads.size()).first->second;
+  _addSpan({.name = std::string(name),
+            .track = std::format("Thread {}", thread),
+            .begin = std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count(),
+            .end = std::chrono::duration_cast<std::chrono::nanoseconds>(end.time_since_epoch()).count(),
+            .frame = frame,
+            .gpu = false});
+}
+
+void Trace::addSpanGPU(std::string_view name, std::string_view track, int64_t begin, int64_t end, uint64_t frame) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _addSpan({.name = std::string(name),
+            .track = std::string(track),
+            .begin = begin,
+            .end = end,
+            .frame = frame,
+            .gpu = true});
+}
+
+void Trace::setCalibration(std::optional<int64_t> offset) noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _calibration = offset;
+}
+
+bool Trace::isCalibrated() const noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _calibration.has_value();
+}
+
+int Trace::getSpanNumber() const noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _spans.size();
+}
+
+void Trace::write(std::string_view path) const {
+  std::unique_lock<std::mutex> lock(_mutex);
+  // GPU spans of frame start after the first submit of the frame at the earliest
+  std::map<uint64_t, int64_t> offsets;
+  if (_calibration.has_value() == false) {
+    std::map<uint64_t, std::pair<int64_t, int64_t>> frames;
+    for (auto&& span : _spans) {
+      auto& [submit, begin] = frames.try_emplace(span.frame, std::numeric_limits<int64_t>::max(),
+                                                 std::numeric_limits<int64_t>::max())
+                                  .first->second;
+      if (span.gpu) begin = std::min(begin, span.begin);
+      if (span.gpu == false && span.name == "Submit") submit = std::min(submit, span.end);
+    }
+    for (auto&& [frame, value] : frames)
+      if (value.first != std::numeric_limits<int64_t>::max() && value.second != std::numeric_limits<int64_t>::max())
+        offsets[frame] = value.first - value.second;
+  }
+
+  struct Event {
+    const Span* span;
+    int64_t begin;
+    int64_t end;
+  };
+  std::vector<Event> events;
+  for (auto&& span : _spans) {
+    int64_t offset = 0;
+    if (span.gpu) {
+      if (_calibration.has_value()) {
+        offset = _calibration.value();
+      } else if (auto frameOffset = offsets.find(span.frame); frameOffset != offsets.end()) {
+        offset = frameOffset->second;
+      } else {
+        continue;
+      }
+    }
+    events.push_back({&span, span.begin + offset, span.end + offset});
+  }
+  int64_t origin = 0;
+  if (events.empty() == false) origin = std::ranges::min(events, {}, &Event::begin).begin;
+
+  std::ofstream file{std::string(path)};
+  if (file.is_open() == false) throw std::runtime_error("Failed to open trace file");
+  auto escape = [](std::string_view text) {
+    std::string escaped;
+    for (char symbol : text) {
+      if (symbol == '"' || symbol == '\\') escaped += '\\';
+      escaped += symbol;
+    }
+    return escaped;
+  };
+  // every track is a thread of CPU or GPU process
+  std::map<std::pair<bool, std::string>, int> tracks;
+  for (auto&& event : events) tracks.try_emplace({event.span->gpu, event.span->track}, tracks.size());
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+  file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}";
+  for (auto&& [track, id] : tracks)
+    file << std::format(
+        ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+        track.first ? 1 : 0, id, escape(track.second));
+  for (auto&& event : events) {
+    auto& span = *event.span;
+    file << std::format(
+        ",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},\"tid\":{},"
+        "\"args\":{{\"frame\":{}}}}}",
+        escape(span.name), span.gpu ? "gpu" : "cpu", (event.begin - origin) / 1000.0,
+        (event.end - event.begin) / 1000.0, span.gpu ? 1 : 0, tracks.at({span.gpu, span.track}), span.frame);
+  }
+  file << "\n]}";
+  if (file.fail()) throw std::runtime_error("Failed to write trace file");
+}
+
+TraceScope::TraceScope(Trace* trace, std::string_view name, uint64_t frame) noexcept
+    : _trace(trace),
+      _name(name),
+      _frame(frame) {
+  if (_trace) _begin = std::chrono::steady_clock::now();
+}
+
+TraceScope::~TraceScope() {
+  if (_trace) _trace->addSpanCPU(_name, _begin, std::chrono::steady_clock::now(), _frame);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+module Workers;
+import <algorithm>;
+using namespace RenderGraph;
+
+Workers::Workers(int threadsNumber) {
+  _resize(threadsNumber);
+  for (int i = 0; i < threadsNumber; i++) _threads.emplace_back([this]() { _run(); });
+}
+
+void Workers::_resize(int capacity) {
+  std::vector<Task*> tasks(capacity);
+  for (int i = 0; i < _size; i++) tasks[i] = _tasks[(_head + i) % _tasks.size()];
+  _tasks = std::move(tasks);
+  _head = 0;
+}
+
+void Workers::_run() {
+  while (true) {
+    Task* task;
+    {
+      std::unique_lock lock(_mutex);
+      _condition.wait(lock, [this]() { return _stop || _size > 0; });
+      if (_size == 0) return;
+      task = _tasks[_head];
+      _head = (_head + 1) % _tasks.size();
+      _size--;
+    }
+    task->execute();
+  }
+}
+
+void Workers::reserve(int capacity) {
+  std::unique_lock lock(_mutex);
+  if (capacity > _tasks.size()) _resize(capacity);
+}
+
+void Workers::push(Task& task) {
+  {
+    std::unique_lock lock(_mutex);
+    if (_size == _tasks.size()) _resize(std::max(1, _size * 2));
+    _tasks[(_head + _size) % _tasks.size()] = &task;
+    _size++;
+  }
+  _condition.notify_one();
+}
+
+int Workers::getThreadsNumber() const noexcept { return _threads.size(); }
+
+Workers::~Workers() {
+  {
+    std::unique_lock lock(_mutex);
+    _stop = true;
+  }
+  _condition.notify_all();
+  // pending tasks are finished before threads exit
+  for (auto&& thread : _threads) thread.join();
+}
\ No newline at end of file
@@ -13,7 +13,10 @@ import Pipeline;
 import Swapchain;
 import Sync;
 import Texture;
+import Statistics;
+import Timestamps;
 import <algorithm>;
+import <filesystem>;
 import <fstream>;
 
 TEST(InstanceTest, CreateWithoutValidation) {
@@ -65,6 +68,14 @@ TEST(DeviceTest, Create) {
   EXPECT_NE(device.getLogicalDevice(), nullptr);
 }
 
+TEST(DeviceTest, CreateHeadless) {
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  EXPECT_NE(device.getPhysicalDevice(), nullptr);
+  EXPECT_NE(device.getLogicalDevice(), nullptr);
+  EXPECT_NE(device.getQueue(vkb::QueueType::graphics), nullptr);
+}
+
 TEST(DeviceTest, SupportedFormatFeature) {
   RenderGraph::Instance instance("TestApp", false);
   RenderGraph::Window window({1920, 1080});
@@ -96,6 +107,65 @@ TEST(DeviceTest, DeviceProperties) {
   EXPECT_GT(properties.apiVersion, 0);
 }
 
+TEST(DeviceTest, DestroyDeferred) {
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window({1920, 1080});
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  auto image = std::make_unique<RenderGraph::Image>(allocator);
+  image->createImage(VK_FORMAT_R8G8B8A8_UNORM, {64, 64}, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_USAGE_SAMPLED_BIT);
+  auto semaphore = std::make_shared<RenderGraph::Semaphore>(VK_SEMAPHORE_TYPE_BINARY, device);
+  std::weak_ptr<RenderGraph::Semaphore> semaphoreWeak = semaphore;
+
+  device.destroyDeferred(std::move(image), 2);
+  // smaller value is queued after bigger one, so it waits for it
+  device.destroyDeferred(std::move(semaphore), 1);
+  EXPECT_EQ(device.getDestroyQueueSize(), 2);
+  device.destroyCompleted(1);
+  EXPECT_EQ(device.getDestroyQueueSize(), 2);
+  EXPECT_FALSE(semaphoreWeak.expired());
+  device.destroyCompleted(2);
+  EXPECT_EQ(device.getDestroyQueueSize(), 0);
+  EXPECT_TRUE(semaphoreWeak.expired());
+}
+
+TEST(DeviceTest, PipelineCache) {
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  EXPECT_NE(device.getPipelineCache(), nullptr);
+  auto path = std::filesystem::temp_directory_path() / "RenderGraphPipelineCache.bin";
+  std::filesystem::remove(path);
+  EXPECT_FALSE(device.loadPipelineCache(path.string()));
+
+  device.savePipelineCache(path.string());
+  EXPECT_TRUE(std::filesystem::exists(path));
+  EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+  // loaded data is merged to the current cache, pipelines compiled before load stay in it
+  auto pipelineCache = device.getPipelineCache();
+  EXPECT_TRUE(device.loadPipelineCache(path.string()));
+  EXPECT_EQ(device.getPipelineCache(), pipelineCache);
+
+  // header of another GPU or driver is rejected
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << "not a pipeline cache of this device";
+  file.close();
+  EXPECT_FALSE(device.loadPipelineCache(path.string()));
+  std::filesystem::remove(path);
+}
+
+TEST(TimestampsTest, Calibration) {
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  RenderGraph::Timestamps timestamps(device);
+  auto calibration = timestamps.getCalibration();
+  EXPECT_EQ(calibration.has_value(), device.isCalibratedTimestamps());
+  // offset of device and host clocks is stable between calibrations, within 1 ms
+  if (calibration.has_value())
+    EXPECT_LT(std::abs(timestamps.getCalibration().value() - calibration.value()), 1'000'000);
+}
+
 TEST(AllocatorTest, Create) {
   RenderGraph::Instance instance("TestApp", false);
   RenderGraph::Window window({1920, 1080});
@@ -647,4 +717,24 @@ TEST(ShaderTest, Reflection) {
   EXPECT_EQ(bindingDescription[1].stride, 100);
   EXPECT_EQ(bindingDescription[1].binding, 1);
   EXPECT_EQ(bindingDescription[1].inputRate, VK_VERTEX_INPUT_RATE_INSTANCE);
+}
+
+TEST(StatisticsTest, Percentiles) {
+  RenderGraph::RollingStatistics statistics(100);
+  EXPECT_EQ(statistics.get().samples, 0);
+  for (int i = 1; i <= 100; i++) statistics.add(i);
+  auto percentiles = statistics.get();
+  EXPECT_EQ(percentiles.samples, 100);
+  EXPECT_EQ(percentiles.p50, 50);
+  EXPECT_EQ(percentiles.p95, 95);
+  EXPECT_EQ(percentiles.p99, 99);
+  EXPECT_EQ(percentiles.max, 100);
+  EXPECT_DOUBLE_EQ(percentiles.mean, 50.5);
+  // the oldest samples are replaced
+  for (int i = 101; i <= 150; i++) statistics.add(i);
+  percentiles = statistics.get();
+  EXPECT_EQ(percentiles.samples, 100);
+  EXPECT_EQ(percentiles.p50, 100);
+  EXPECT_EQ(percentiles.max, 150);
+  EXPECT_THROW(RenderGraph::RollingStatistics(0), std::runtime_error);
 }
\ No newline at end of file
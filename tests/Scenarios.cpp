@@ -1,4 +1,7 @@
 #include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 import Instance;
 import Window;
 import Surface;
@@ -9,7 +12,28 @@ import Graph;
 import Texture;
 import CommandPool;
 import Command;
+import Buffer;
+import Trace;
 import glm;
+import <chrono>;
+import <filesystem>;
+import <fstream>;
+import <sstream>;
+import <string>;
+
+// every allocation of the test executable goes through here, counted only while enabled
+std::atomic<bool> countAllocations = false;
+std::atomic<int> allocations = 0;
+
+void* operator new(std::size_t size) {
+  if (countAllocations) allocations++;
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, std::size_t size) noexcept { std::free(pointer); }
 
 class GraphElementMock : public RenderGraph::GraphElement {
  private:
@@ -30,6 +54,11 @@ class GraphElementMock : public RenderGraph::GraphElement {
   int getResetCount() const noexcept { return _resetCount; }
 };
 
+class GraphElementSeparateMock : public GraphElementMock {
+ public:
+  bool isRenderingScopeSeparate() const noexcept override { return true; }
+};
+
 TEST(ScenarioTest, GraphOneQueue) {
   glm::ivec2 resolution(1920, 1080);
   RenderGraph::Instance instance("TestApp", false);
@@ -167,6 +196,8 @@ TEST(ScenarioTest, GraphOneQueue) {
   vkWaitSemaphores(device.getLogicalDevice(), &waitInfo, UINT64_MAX);
 
   graph.render();
+  // timestamps are read back only after GPU finishes the frame
+  vkDeviceWaitIdle(device.getLogicalDevice());
   auto timestamps1 = graph.getTimestamps();
   EXPECT_EQ(timestamps1.size(), 3);
   EXPECT_TRUE(timestamps1.find("Render") != timestamps1.end());
@@ -182,6 +213,7 @@ TEST(ScenarioTest, GraphOneQueue) {
   EXPECT_EQ(elementMock->getDrawCount(), 3);
   graph.render();
 
+  vkDeviceWaitIdle(device.getLogicalDevice());
   auto timestamps2 = graph.getTimestamps();
   EXPECT_EQ(graph.getFrameInFlight(), (2 % framesInFlight));
   EXPECT_EQ(elementMock->getDrawCount(), 6);
@@ -334,6 +366,8 @@ TEST(ScenarioTest, GraphSeparateQueues) {
   vkWaitSemaphores(device.getLogicalDevice(), &waitInfo, UINT64_MAX);
 
   graph.render();
+  // timestamps are read back only after GPU finishes the frame
+  vkDeviceWaitIdle(device.getLogicalDevice());
   auto timestamps1 = graph.getTimestamps();
   EXPECT_EQ(timestamps1.size(), 3);
   EXPECT_TRUE(timestamps1.find("Render") != timestamps1.end());
@@ -349,6 +383,7 @@ TEST(ScenarioTest, GraphSeparateQueues) {
   EXPECT_EQ(elementMock->getDrawCount(), 3);
   graph.render();
 
+  vkDeviceWaitIdle(device.getLogicalDevice());
   auto timestamps2 = graph.getTimestamps();
   EXPECT_EQ(graph.getFrameInFlight(), (2 % framesInFlight));
   EXPECT_EQ(elementMock->getDrawCount(), 6);
@@ -491,6 +526,13 @@ TEST(ScenarioTest, GraphReset) {
               nullptr);
   }
 
+  // old swapchain is destroyed only after frames that could use it are finished
+  EXPECT_EQ(swapchain.getRetiredCount(), 1);
+  for (int i = 0; i <= framesInFlight; i++) {
+    graph.render();
+  }
+  EXPECT_EQ(swapchain.getRetiredCount(), 0);
+
   // the most important here is the resolution
   std::vector<std::shared_ptr<RenderGraph::ImageView>> swapchainNewImages;
   for (int i = 0; i < swapchainOldImages.size(); i++) {
@@ -575,7 +617,10 @@ TEST(ScenarioTest, DepthExistance) {
   renderPass.addColorTarget("Swapchain");
   renderPass.setDepthTarget("Depth");
   renderPass.clearTarget("Swapchain");
-  renderPass.clearTarget("Depth");
+  // depth is cleared and used only inside the pass, so it isn't stored
+  renderPass.clearTarget("Depth", VkClearValue{.depthStencil = {1.f, 0}});
+  EXPECT_TRUE(renderPass.isCleared("Depth"));
+  EXPECT_FALSE(renderPass.isCleared("Missing"));
   renderPass.registerGraphElement(elementMock);
 
   graph.calculate();
@@ -610,6 +655,1227 @@ TEST(ScenarioTest, DepthExistance) {
 
   graph.render();
 
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphAttachmentOps) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+  std::vector<std::shared_ptr<RenderGraph::ImageView>> depthViews;
+  for (int i = 0; i < framesInFlight; i++) {
+    auto image = std::make_unique<RenderGraph::Image>(allocator);
+    image->createImage(VK_FORMAT_D32_SFLOAT, resolution, 1, 1, VK_IMAGE_ASPECT_DEPTH_BIT,
+                       VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+    imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+    depthViews.push_back(imageView);
+  }
+  graph.getGraphStorage().add("Depth", std::make_unique<RenderGraph::ImageViewHolder>(
+                                           depthViews, [&]() { return graph.getFrameInFlight(); }));
+  graph.getGraphStorage().setTransient("Depth");
+
+  auto& geometryPass = graph.createPassGraphic("Geometry");
+  geometryPass.addColorTarget("Swapchain");
+  geometryPass.setDepthTarget("Depth");
+  geometryPass.clearTarget("Swapchain");
+  auto& guiPass = graph.createPassGraphic("GUI");
+  guiPass.addColorTarget("Swapchain");
+  graph.calculate();
+
+  auto& geometry = geometryPass.getRenderingInfo(0, 0);
+  EXPECT_EQ(geometry.pColorAttachments[0].loadOp, VK_ATTACHMENT_LOAD_OP_CLEAR);
+  // swapchain is loaded by the next pass
+  EXPECT_EQ(geometry.pColorAttachments[0].storeOp, VK_ATTACHMENT_STORE_OP_STORE);
+  // transient depth is used only by this pass
+  EXPECT_EQ(geometry.pDepthAttachment->loadOp, VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+  EXPECT_EQ(geometry.pDepthAttachment->storeOp, VK_ATTACHMENT_STORE_OP_DONT_CARE);
+  auto& gui = guiPass.getRenderingInfo(0, 0);
+  EXPECT_EQ(gui.pColorAttachments[0].loadOp, VK_ATTACHMENT_LOAD_OP_LOAD);
+  // presented image has to be stored by the last pass
+  EXPECT_EQ(gui.pColorAttachments[0].storeOp, VK_ATTACHMENT_STORE_OP_STORE);
+}
+
+TEST(ScenarioTest, GraphAliasing) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+
+  auto createTarget = [&](std::string_view name) {
+    std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+    for (int i = 0; i < framesInFlight; i++) {
+      auto image = std::make_unique<RenderGraph::Image>(allocator);
+      image->createImage(VK_FORMAT_R16G16B16A16_SFLOAT, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+      image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                          commandBuffer);
+      auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+      imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+      imageViews.push_back(imageView);
+    }
+    graph.getGraphStorage().add(name, std::make_unique<RenderGraph::ImageViewHolder>(
+                                          imageViews, [&]() { return graph.getFrameInFlight(); }));
+    graph.getGraphStorage().setTransient(name);
+  };
+  // GBuffer is dead after Lighting, so Tonemap can reuse its memory
+  createTarget("GBuffer");
+  createTarget("Lighting");
+  createTarget("Tonemap");
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& geometryPass = graph.createPassGraphic("Geometry");
+  geometryPass.addColorTarget("GBuffer");
+  geometryPass.clearTarget("GBuffer");
+  geometryPass.registerGraphElement(elementMock);
+
+  auto& lightingPass = graph.createPassGraphic("Lighting");
+  lightingPass.addTextureInput("GBuffer");
+  lightingPass.addColorTarget("Lighting");
+  lightingPass.registerGraphElement(elementMock);
+
+  auto& tonemapPass = graph.createPassGraphic("Tonemap");
+  tonemapPass.addTextureInput("Lighting");
+  tonemapPass.addColorTarget("Tonemap");
+  tonemapPass.registerGraphElement(elementMock);
+
+  auto& guiPass = graph.createPassGraphic("GUI");
+  guiPass.addTextureInput("Tonemap");
+  guiPass.addColorTarget("Swapchain");
+  guiPass.registerGraphElement(elementMock);
+
+  auto gbufferImage = graph.getGraphStorage().getImageViewHolder("GBuffer").getImageViews()[0]->getImage().getImage();
+  graph.calculate();
+
+  auto statistics = graph.getAliasingStatistics();
+  EXPECT_GT(statistics.naiveSize, 0);
+  EXPECT_LT(statistics.peakSize, statistics.naiveSize);
+  // images were recreated in the shared memory
+  EXPECT_NE(graph.getGraphStorage().getImageViewHolder("GBuffer").getImageViews()[0]->getImage().getImage(),
+            gbufferImage);
+  EXPECT_EQ(elementMock->getResetCount(), 4);
+
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+
+  for (int i = 0; i < 10; i++) {
+    graph.render();
+  }
+  EXPECT_EQ(elementMock->getDrawCount(), 4 * 10);
+
+  // resources are aliased again while frames are in flight
+  graph.calculate();
+  EXPECT_EQ(elementMock->getResetCount(), 8);
+  for (int i = 0; i < 10; i++) {
+    graph.render();
+  }
+  EXPECT_EQ(elementMock->getDrawCount(), 4 * 20);
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphAliasingBuffers) {
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::GraphStorage storage;
+  auto addBuffer = [&](std::string_view name, VmaAllocationCreateFlags flags) {
+    std::vector<std::unique_ptr<RenderGraph::Buffer>> buffers;
+    buffers.push_back(
+        std::make_unique<RenderGraph::Buffer>(1024, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, flags, allocator));
+    storage.add(name, buffers);
+    storage.setTransient(name);
+  };
+  addBuffer("Particles", 0);
+  addBuffer("Density", 0);
+  addBuffer("Uniform", VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+  addBuffer("Constants", VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+  // integrated GPU can put device local buffer to mappable memory
+  bool hostVisible = storage.getBuffer("Particles")[0]->isHostVisible();
+  storage.alias({{"Particles", {0, 0}}, {"Density", {1, 1}}, {"Uniform", {0, 0}}, {"Constants", {1, 1}}}, device);
+
+  // mapped buffers keep their own allocation and mapping
+  EXPECT_FALSE(storage.getAliasedBuffers().contains("Uniform"));
+  EXPECT_FALSE(storage.getAliasedBuffers().contains("Constants"));
+  EXPECT_NE(storage.getBuffer("Uniform")[0]->getAllocationInfo().pMappedData, nullptr);
+  EXPECT_EQ(storage.getAliasedBuffers().contains("Particles"), hostVisible == false);
+
+  // lifetimes overlap now, so buffers leave shared memory
+  storage.alias({{"Particles", {0, 1}}, {"Density", {1, 1}}, {"Uniform", {0, 0}}, {"Constants", {1, 1}}}, device);
+  EXPECT_TRUE(storage.getAliasedBuffers().empty());
+  EXPECT_FALSE(storage.getBuffer("Particles")[0]->isAliased());
+  EXPECT_FALSE(storage.getBuffer("Density")[0]->isAliased());
+  EXPECT_EQ(storage.getRestored().contains("Particles"), hostVisible == false);
+  // aliased again for the next check
+  storage.alias({{"Particles", {0, 0}}, {"Density", {1, 1}}, {"Uniform", {0, 0}}, {"Constants", {1, 1}}}, device);
+
+  // aliased buffer is filled through staging buffer
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  std::vector<std::byte> data(1024);
+  storage.getBuffer("Particles")[0]->setData(data, commandBuffer);
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+
+TEST(ScenarioTest, GraphCulling) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+
+  auto createTarget = [&](std::string_view name) {
+    std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+    for (int i = 0; i < framesInFlight; i++) {
+      auto image = std::make_unique<RenderGraph::Image>(allocator);
+      image->createImage(VK_FORMAT_R16G16B16A16_SFLOAT, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+      image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                          commandBuffer);
+      auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+      imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+      imageViews.push_back(imageView);
+    }
+    graph.getGraphStorage().add(name, std::make_unique<RenderGraph::ImageViewHolder>(
+                                          imageViews, [&]() { return graph.getFrameInFlight(); }));
+  };
+  createTarget("Debug");
+  createTarget("Screenshot");
+  graph.getGraphStorage().setExported("Screenshot");
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto elementDebugMock = std::make_shared<GraphElementMock>();
+  // nobody reads debug target, so pass has to be culled
+  auto& debugPass = graph.createPassGraphic("Debug");
+  debugPass.addColorTarget("Debug");
+  debugPass.registerGraphElement(elementDebugMock);
+
+  auto& screenshotPass = graph.createPassGraphic("Screenshot");
+  screenshotPass.addColorTarget("Screenshot");
+  screenshotPass.registerGraphElement(elementMock);
+
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Swapchain");
+  renderPass.clearTarget("Swapchain");
+  renderPass.registerGraphElement(elementMock);
+
+  graph.calculate();
+  EXPECT_EQ(graph.getPassesCulled().size(), 1);
+  EXPECT_EQ(graph.getPassesCulled().front(), &debugPass);
+
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+
+  for (int i = 0; i < 10; i++) {
+    graph.render();
+  }
+  auto timestamps = graph.getTimestamps();
+  EXPECT_EQ(timestamps.size(), 2);
+  EXPECT_TRUE(timestamps.find("Debug") == timestamps.end());
+  EXPECT_EQ(elementDebugMock->getDrawCount(), 0);
+  EXPECT_EQ(elementMock->getDrawCount(), 2 * 10);
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+
+TEST(ScenarioTest, GraphCycle) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+
+  // Compose reads Blur which is produced from Compose's output
+  auto& composePass = graph.createPassGraphic("Compose");
+  composePass.addTextureInput("Blur");
+  composePass.addColorTarget("Swapchain");
+
+  auto& blurPass = graph.createPassCompute("Blur", false);
+  blurPass.addStorageTextureInput("Swapchain");
+  blurPass.addStorageTextureOutput("Blur");
+
+  EXPECT_THROW(graph.calculate(), std::runtime_error);
+}
+
+TEST(ScenarioTest, GraphCulledEverything) {
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  RenderGraph::Graph graph(4, 2, device);
+  graph.initialize();
+
+  // nothing is exported, so nothing is alive
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Output");
+  auto& postPass = graph.createPassCompute("Post", false);
+  postPass.addStorageTextureInput("Output");
+  postPass.addStorageTextureOutput("Post");
+
+  EXPECT_THROW(graph.calculate(), std::runtime_error);
+  EXPECT_EQ(graph.getPassesCulled().size(), 2);
+}
+
+
+TEST(ScenarioTest, GraphResourceAccess) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+
+  // compute output is consumed by graphics pass on the same queue
+  auto& particlesPass = graph.createPassCompute("Particles", false);
+  particlesPass.addStorageBufferOutput("Particles");
+  particlesPass.addStorageTextureOutput("Density");
+
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Swapchain");
+  renderPass.setDepthTarget("Depth");
+  renderPass.addTextureInput("Density");
+
+  auto particlesAccesses = particlesPass.getResourceAccesses();
+  EXPECT_FALSE(particlesAccesses.at("Particles").image);
+  EXPECT_EQ(particlesAccesses.at("Density").stage, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+  EXPECT_EQ(particlesAccesses.at("Density").accessWrite, VK_ACCESS_2_SHADER_WRITE_BIT);
+
+  auto renderAccesses = renderPass.getResourceAccesses();
+  EXPECT_EQ(renderAccesses.at("Depth").stage,
+            VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT);
+  EXPECT_EQ(renderAccesses.at("Depth").accessWrite, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+  EXPECT_EQ(renderAccesses.at("Density").accessWrite, VK_ACCESS_2_NONE);
+  EXPECT_EQ(renderAccesses.at("Swapchain").stage, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+  graph.calculate();
+  // acquire semaphore blocks only the stage that writes to swapchain
+  EXPECT_EQ(renderPass.getWaitStages().size(), 1);
+  EXPECT_EQ(renderPass.getWaitStages().front(), VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+  EXPECT_EQ(particlesPass.getWaitStages().size(), 0);
+}
+
+TEST(ScenarioTest, GraphAsyncCompute) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+
+  // particles are simulated on compute queue while shadows are rendered, queues join only before render
+  auto& particlesPass = graph.createPassCompute("Particles", true);
+  particlesPass.addStorageTextureOutput("Density");
+
+  auto& shadowPass = graph.createPassGraphic("Shadow");
+  shadowPass.addColorTarget("Shadow");
+
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addTextureInput("Shadow");
+  renderPass.addTextureInput("Density");
+  renderPass.addColorTarget("Swapchain");
+
+  graph.calculate();
+  EXPECT_EQ(particlesPass.getWaitSemaphores().size(), 0);
+  EXPECT_EQ(particlesPass.getSignalSemaphores().size(), 1);
+  EXPECT_EQ(shadowPass.getWaitSemaphores().size(), 0);
+  EXPECT_EQ(shadowPass.getSignalSemaphores().size(), 0);
+  // swapchain and particles
+  EXPECT_EQ(renderPass.getWaitSemaphores().size(), 2);
+  // render finished semaphore is signaled by the last submission, not by the pass
+  EXPECT_EQ(renderPass.getSignalSemaphores().size(), 0);
+
+  // semaphores of the previous calculate are replaced, not duplicated
+  graph.calculate();
+  EXPECT_EQ(particlesPass.getSignalSemaphores().size(), 1);
+  EXPECT_EQ(renderPass.getWaitSemaphores().size(), 2);
+  EXPECT_EQ(renderPass.getWaitStages().size(), 2);
+  EXPECT_EQ(renderPass.getSignalSemaphores().size(), 0);
+}
+
+TEST(ScenarioTest, GraphParallelRecording) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+
+  // number of elements isn't divisible by number of threads
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Swapchain");
+  renderPass.clearTarget("Swapchain");
+  for (int i = 0; i < 101; i++) renderPass.registerGraphElement(elementMock);
+  renderPass.setParallelRecording(4);
+  EXPECT_TRUE(renderPass.isParallelRecording());
+
+  graph.calculate();
+  for (int i = 0; i < 10; i++) {
+    graph.render();
+  }
+  EXPECT_EQ(elementMock->getDrawCount(), 101 * 10);
+  EXPECT_EQ(elementMock->getUpdateCount(), 101 * 10);
+
+  renderPass.setParallelRecording(0);
+  EXPECT_FALSE(renderPass.isParallelRecording());
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphStaticPass) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Swapchain");
+  renderPass.clearTarget("Swapchain");
+  renderPass.registerGraphElement(elementMock);
+  renderPass.setStatic(true);
+  EXPECT_TRUE(renderPass.isStatic());
+
+  graph.calculate();
+  // one recording per frame in flight and swapchain image at most
+  int recordings = framesInFlight * swapchain.getImageViews().size();
+  for (int i = 0; i < 10 * recordings; i++) {
+    graph.render();
+  }
+  auto drawCount = elementMock->getDrawCount();
+  EXPECT_GT(drawCount, 0);
+  EXPECT_LE(drawCount, recordings);
+
+  // changed element forces pass to be recorded again
+  elementMock->markDirty();
+  graph.render();
+  EXPECT_EQ(elementMock->getDrawCount(), drawCount + 1);
+
+  // registered element has version 0, pass is recorded again anyway
+  auto version = renderPass.getVersion();
+  auto elementNew = std::make_shared<GraphElementMock>();
+  renderPass.registerGraphElement(elementNew);
+  EXPECT_NE(renderPass.getVersion(), version);
+  graph.render();
+  EXPECT_EQ(elementNew->getDrawCount(), 1);
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphHistoryTarget) {
+  glm::ivec2 resolution(640, 480);
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, device);
+  graph.initialize();
+
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+  for (int i = 0; i < 2; i++) {
+    auto image = std::make_unique<RenderGraph::Image>(allocator);
+    image->createImage(VK_FORMAT_R8G8B8A8_UNORM, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                        commandBuffer);
+    auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+    imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+    imageViews.push_back(imageView);
+  }
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+
+  // copy is picked by the application (e.g. history ping-pong), not by frame in flight
+  int historyIndex = 1;
+  graph.getGraphStorage().add("History", std::make_unique<RenderGraph::ImageViewHolder>(
+                                             imageViews, [&historyIndex]() { return historyIndex; }));
+  graph.getGraphStorage().setExported("History");
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("History");
+  renderPass.registerGraphElement(elementMock);
+  renderPass.setStatic(true);
+  graph.calculate();
+
+  for (int i = 0; i < 10; i++) graph.render();
+  // one recording per frame in flight
+  EXPECT_EQ(elementMock->getDrawCount(), framesInFlight);
+
+  // static pass recorded with the other copy is recorded again for every frame in flight
+  historyIndex = 0;
+  for (int i = 0; i < 10; i++) graph.render();
+  EXPECT_GT(elementMock->getDrawCount(), 2 * framesInFlight - 1);
+  EXPECT_LE(elementMock->getDrawCount(), 3 * framesInFlight);
+
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphStorageHandles) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+  swapchain.initialize();
+  graph.initialize();
+
+  auto& graphStorage = graph.getGraphStorage();
+  auto handleSwapchain = graphStorage.add(
+      "Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                       swapchain.getImageViews(), [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+  EXPECT_GE(handleSwapchain.index, 0);
+  EXPECT_EQ(graphStorage.getImageHandle("Swapchain"), handleSwapchain);
+  EXPECT_EQ(graphStorage.getName(handleSwapchain), "Swapchain");
+  EXPECT_EQ(&graphStorage.getImageViewHolder(handleSwapchain), &graphStorage.getImageViewHolder("Swapchain"));
+  EXPECT_EQ(graphStorage.getImageHandle("Missing").index, -1);
+  EXPECT_EQ(graphStorage.getBufferHandle("Swapchain").index, -1);
+  // typo in resource name fails instead of reading past the end
+  EXPECT_THROW(graphStorage.getImageViewHolder("Missing"), std::runtime_error);
+  EXPECT_THROW(graphStorage.getBuffer("Missing"), std::runtime_error);
+
+  // replaced resource keeps its handle
+  auto handleReplaced = graphStorage.add(
+      "Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                       swapchain.getImageViews(), [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+  EXPECT_EQ(handleReplaced, handleSwapchain);
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Swapchain");
+  renderPass.clearTarget("Swapchain");
+  renderPass.registerGraphElement(elementMock);
+
+  graph.calculate();
+  graph.render();
+  EXPECT_EQ(elementMock->getDrawCount(), 1);
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphRenderingScope) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+
+  // shared scope is split by element with its own scope
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto elementSeparateMock = std::make_shared<GraphElementSeparateMock>();
+  EXPECT_FALSE(elementMock->isRenderingScopeSeparate());
+  EXPECT_TRUE(elementSeparateMock->isRenderingScopeSeparate());
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Swapchain");
+  renderPass.clearTarget("Swapchain");
+  renderPass.registerGraphElement(elementMock);
+  renderPass.registerGraphElement(elementMock);
+  renderPass.registerGraphElement(elementSeparateMock);
+  renderPass.registerGraphElement(elementMock);
+
+  graph.calculate();
+  for (int i = 0; i < 3; i++) {
+    graph.render();
+  }
+  EXPECT_EQ(elementMock->getUpdateCount(), 3 * 3);
+  EXPECT_EQ(elementMock->getDrawCount(), 3 * 3);
+  EXPECT_EQ(elementSeparateMock->getUpdateCount(), 3);
+  EXPECT_EQ(elementSeparateMock->getDrawCount(), 3);
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphLateAcquire) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  RenderGraph::Swapchain swapchain(resolution, allocator, device);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+  std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+  for (int i = 0; i < framesInFlight; i++) {
+    auto image = std::make_unique<RenderGraph::Image>(allocator);
+    image->createImage(VK_FORMAT_R16G16B16A16_SFLOAT, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                        commandBuffer);
+    auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+    imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+    imageViews.push_back(imageView);
+  }
+  graph.getGraphStorage().add("Offscreen", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               imageViews, [&]() { return graph.getFrameInFlight(); }));
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+
+  // offscreen pass doesn't touch swapchain, so it's recorded before swapchain image is acquired and doesn't depend on
+  // its index
+  auto elementOffscreenMock = std::make_shared<GraphElementMock>();
+  auto& offscreenPass = graph.createPassGraphic("Offscreen");
+  offscreenPass.addColorTarget("Offscreen");
+  offscreenPass.clearTarget("Offscreen");
+  offscreenPass.registerGraphElement(elementOffscreenMock);
+  offscreenPass.setStatic(true);
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addTextureInput("Offscreen");
+  renderPass.addColorTarget("Swapchain");
+  renderPass.registerGraphElement(elementMock);
+
+  graph.calculate();
+  for (int i = 0; i < 10; i++) {
+    graph.render();
+  }
+  // static pass is recorded once per frame in flight instead of once per frame in flight and swapchain image
+  EXPECT_EQ(elementOffscreenMock->getDrawCount(), framesInFlight);
+  EXPECT_EQ(elementMock->getDrawCount(), 10);
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphFramePacing) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false);
+  RenderGraph::Window window(resolution);
+  window.initialize();
+  RenderGraph::Surface surface(window, instance);
+  RenderGraph::Device device(surface, instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  // FIFO is always supported
+  RenderGraph::Swapchain swapchain(resolution, allocator, device, VK_PRESENT_MODE_FIFO_KHR);
+  EXPECT_EQ(swapchain.getPresentMode(), VK_PRESENT_MODE_FIFO_KHR);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, swapchain, window, device);
+  swapchain.initialize();
+  graph.initialize();
+
+  graph.getGraphStorage().add("Swapchain", std::make_unique<RenderGraph::ImageViewHolder>(
+                                               swapchain.getImageViews(),
+                                               [&swapchain]() { return swapchain.getSwapchainIndex(); }));
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Swapchain");
+  renderPass.clearTarget("Swapchain");
+  renderPass.registerGraphElement(elementMock);
+  graph.calculate();
+
+  // limit can't exceed frames in flight resources are allocated for
+  EXPECT_THROW(graph.setMaxFramesInFlight(framesInFlight + 1), std::runtime_error);
+  EXPECT_THROW(graph.setMaxFramesInFlight(0), std::runtime_error);
+  graph.setMaxFramesInFlight(1);
+  EXPECT_EQ(graph.getMaxFramesInFlight(), 1);
+
+  // limiter doesn't let frames start more often than frame time
+  auto frameTime = std::chrono::milliseconds(20);
+  graph.setFrameTime(frameTime);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; i++) {
+    graph.render();
+  }
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 4 * frameTime);
+  graph.setFrameTime(std::chrono::nanoseconds(0));
+
+  // present mode and image count are applied by reset
+  vkDeviceWaitIdle(device.getLogicalDevice());
+  swapchain.setPresentMode(VK_PRESENT_MODE_FIFO_RELAXED_KHR);
+  swapchain.setMinImageCount(swapchain.getImageCount() + 1);
+  graph.reset();
+  for (int i = 0; i < 5; i++) {
+    graph.render();
+  }
+  EXPECT_EQ(elementMock->getDrawCount(), 10);
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphHeadless) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, device);
+  EXPECT_TRUE(graph.isHeadless());
+
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  graph.initialize();
+
+  // output of the graph is an ordinary image in graph storage
+  std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+  for (int i = 0; i < framesInFlight; i++) {
+    auto image = std::make_unique<RenderGraph::Image>(allocator);
+    image->createImage(VK_FORMAT_R8G8B8A8_UNORM, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                        commandBuffer);
+    auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+    imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+    imageViews.push_back(imageView);
+  }
+  graph.getGraphStorage().add("Output", std::make_unique<RenderGraph::ImageViewHolder>(
+                                            imageViews, [&]() { return graph.getFrameInFlight(); }));
+  graph.getGraphStorage().setExported("Output");
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Output");
+  renderPass.clearTarget("Output");
+  renderPass.registerGraphElement(elementMock);
+
+  graph.setStatisticsWindow(4);
+  graph.calculate();
+  // nothing is presented, so reset is never needed
+  for (int i = 0; i < 10; i++) {
+    EXPECT_FALSE(graph.render());
+  }
+  EXPECT_EQ(elementMock->getDrawCount(), 10);
+  EXPECT_EQ(graph.getFrameValue(), 11);
+  EXPECT_THROW(graph.reset(), std::runtime_error);
+
+  // statistics keep only the window, GPU samples are added when timestamps are read back
+  vkDeviceWaitIdle(device.getLogicalDevice());
+  graph.getTimestamps();
+  auto frameCPU = graph.getFrameStatisticsCPU();
+  EXPECT_EQ(frameCPU.samples, 4);
+  EXPECT_GT(frameCPU.mean, 0);
+  EXPECT_LE(frameCPU.p50, frameCPU.p95);
+  EXPECT_LE(frameCPU.p95, frameCPU.p99);
+  EXPECT_LE(frameCPU.p99, frameCPU.max);
+  EXPECT_EQ(graph.getPassStatisticsCPU("Render").samples, 4);
+  EXPECT_EQ(graph.getPassStatisticsGPU("Render").samples, 4);
+  EXPECT_EQ(graph.getFrameStatisticsGPU().samples, 4);
+  EXPECT_EQ(graph.getPassStatisticsGPU("Unknown").samples, 0);
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphBatch) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  int framesInFlight = 3;
+  RenderGraph::Graph graph(4, framesInFlight, device);
+
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  graph.initialize();
+
+  std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+  for (int i = 0; i < framesInFlight; i++) {
+    auto image = std::make_unique<RenderGraph::Image>(allocator);
+    image->createImage(VK_FORMAT_R8G8B8A8_UNORM, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+    image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                        commandBuffer);
+    auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+    imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+    imageViews.push_back(imageView);
+  }
+  graph.getGraphStorage().add("Output", std::make_unique<RenderGraph::ImageViewHolder>(
+                                            imageViews, [&]() { return graph.getFrameInFlight(); }));
+  graph.getGraphStorage().setExported("Output");
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Output");
+  renderPass.clearTarget("Output");
+  renderPass.registerGraphElement(elementMock);
+  auto& postprocessPass = graph.createPassCompute("Postprocess", false);
+  postprocessPass.addStorageTextureInput("Output");
+  postprocessPass.addStorageTextureOutput("Output");
+  postprocessPass.registerGraphElement(elementMock);
+
+  graph.calculate();
+  // iterations use different frames in flight, so there can't be more of them
+  EXPECT_THROW(graph.renderBatch(framesInFlight + 1), std::runtime_error);
+  for (int i = 0; i < 4; i++) {
+    graph.renderBatch(framesInFlight);
+  }
+  EXPECT_EQ(elementMock->getDrawCount(), 2 * 4 * framesInFlight);
+  EXPECT_EQ(graph.getFrameValue(), 4 * framesInFlight + 1);
+  // batch and ordinary frames can be mixed
+  EXPECT_FALSE(graph.render());
+  EXPECT_EQ(elementMock->getDrawCount(), 2 * (4 * framesInFlight + 1));
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphZeroAllocation) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  int framesInFlight = 2;
+  // passes are recorded by this thread, then by workers with parallel recording of chunks
+  for (int threadsNumber : {0, 2}) {
+    SCOPED_TRACE(threadsNumber);
+    allocations = 0;
+    RenderGraph::Graph graph(threadsNumber, framesInFlight, device);
+
+    auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+    RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+    commandBuffer.beginCommands();
+    graph.initialize();
+
+    std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+    for (int i = 0; i < framesInFlight; i++) {
+      auto image = std::make_unique<RenderGraph::Image>(allocator);
+      image->createImage(VK_FORMAT_R8G8B8A8_UNORM, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+      image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                          commandBuffer);
+      auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+      imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+      imageViews.push_back(imageView);
+    }
+    graph.getGraphStorage().add("Output", std::make_unique<RenderGraph::ImageViewHolder>(
+                                              imageViews, [&]() { return graph.getFrameInFlight(); }));
+    graph.getGraphStorage().setExported("Output");
+    commandBuffer.endCommands();
+    VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                               .commandBufferCount = 1,
+                               .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+    vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+    vkDeviceWaitIdle(device.getLogicalDevice());
+
+    auto elementMock = std::make_shared<GraphElementMock>();
+    auto& renderPass = graph.createPassGraphic("Render with a name longer than small string");
+    renderPass.addColorTarget("Output");
+    renderPass.clearTarget("Output");
+    for (int i = 0; i < 4; i++) renderPass.registerGraphElement(std::make_shared<GraphElementMock>());
+    if (threadsNumber > 0) renderPass.setParallelRecording(threadsNumber);
+    auto& postprocessPass = graph.createPassCompute("Postprocess with a name longer than small string", false);
+    postprocessPass.addStorageTextureInput("Output");
+    postprocessPass.addStorageTextureOutput("Output");
+    postprocessPass.registerGraphElement(elementMock);
+    graph.calculate();
+
+    // the first frames fill scratch storage that is reused later
+    for (int i = 0; i < 2 * framesInFlight; i++) {
+      graph.render();
+    }
+    countAllocations = true;
+    for (int i = 0; i < 10; i++) {
+      graph.render();
+    }
+    countAllocations = false;
+    EXPECT_EQ(allocations, 0);
+    EXPECT_EQ(elementMock->getDrawCount(), 2 * framesInFlight + 10);
+    EXPECT_EQ(graph.getTimestamps().size(), 2);
+
+    // wait device idle before destroying resources
+    vkDeviceWaitIdle(device.getLogicalDevice());
+  }
+}
+
+TEST(ScenarioTest, GraphTimestampsScalable) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, device);
+
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  graph.initialize();
+
+  std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+  for (int i = 0; i < framesInFlight; i++) {
+    auto image = std::make_unique<RenderGraph::Image>(allocator);
+    image->createImage(VK_FORMAT_R8G8B8A8_UNORM, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                       VK_IMAGE_USAGE_STORAGE_BIT);
+    image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                        commandBuffer);
+    auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+    imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+    imageViews.push_back(imageView);
+  }
+  graph.getGraphStorage().add("Output", std::make_unique<RenderGraph::ImageViewHolder>(
+                                            imageViews, [&]() { return graph.getFrameInFlight(); }));
+  graph.getGraphStorage().setExported("Output");
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+
+  // more passes than the old fixed query pool could hold, every pass gets its own queries
+  int passNumber = 200;
+  auto elementMock = std::make_shared<GraphElementMock>();
+  for (int i = 0; i < passNumber; i++) {
+    auto& pass = graph.createPassCompute("Pass " + std::to_string(i), false);
+    pass.addStorageTextureInput("Output");
+    pass.addStorageTextureOutput("Output");
+    pass.registerGraphElement(elementMock);
+  }
+  // element scopes are allocated concurrently by chunks of parallel recording
+  int elementNumber = 8;
+  auto& elementsPass = graph.createPassCompute("Elements", false);
+  elementsPass.addStorageTextureInput("Output");
+  elementsPass.addStorageTextureOutput("Output");
+  for (int i = 0; i < elementNumber; i++) elementsPass.registerGraphElement(std::make_shared<GraphElementMock>());
+  elementsPass.setParallelRecording(3);
+  elementsPass.setElementTimestamps(true);
+  graph.calculate();
+
+  for (int i = 0; i < 3; i++) {
+    graph.render();
+  }
+  // results don't wait for GPU, but frame in flight being reused has been read back already
+  uint64_t frame = 0;
+  graph.getTimestamps(&frame);
+  EXPECT_GE(frame, 1);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+  auto timestamps = graph.getTimestamps(&frame);
+  EXPECT_EQ(frame, 3);
+  EXPECT_EQ(timestamps.size(), passNumber + 1 + elementNumber);
+  EXPECT_TRUE(timestamps.contains("Pass 199"));
+  EXPECT_TRUE(timestamps.contains("Elements/7"));
+  // element scope is nested in its pass
+  EXPECT_GE(timestamps["Elements/0"].x, timestamps["Elements"].x);
+  EXPECT_LE(timestamps["Elements/0"].y, timestamps["Elements"].y);
+  EXPECT_EQ(elementMock->getDrawCount(), 3 * passNumber);
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphTrace) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, device);
+
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  graph.initialize();
+
+  std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+  for (int i = 0; i < framesInFlight; i++) {
+    auto image = std::make_unique<RenderGraph::Image>(allocator);
+    image->createImage(VK_FORMAT_R8G8B8A8_UNORM, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+    image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                        commandBuffer);
+    auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+    imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+    imageViews.push_back(imageView);
+  }
+  graph.getGraphStorage().add("Output", std::make_unique<RenderGraph::ImageViewHolder>(
+                                            imageViews, [&]() { return graph.getFrameInFlight(); }));
+  graph.getGraphStorage().setExported("Output");
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Output");
+  renderPass.clearTarget("Output");
+  renderPass.registerGraphElement(elementMock);
+  auto& postprocessPass = graph.createPassCompute("Postprocess", true);
+  postprocessPass.addStorageTextureInput("Output");
+  postprocessPass.addStorageTextureOutput("Output");
+  postprocessPass.registerGraphElement(elementMock);
+  graph.calculate();
+
+  // only the last 3 frames are kept
+  RenderGraph::Trace trace(3);
+  graph.setTrace(&trace);
+  EXPECT_EQ(trace.getSpanNumber(), 0);
+  for (int i = 0; i < 5; i++) {
+    graph.render();
+  }
+  vkDeviceWaitIdle(device.getLogicalDevice());
+  // the last frame is read back
+  graph.getTimestamps();
+  graph.setTrace(nullptr);
+  EXPECT_EQ(trace.isCalibrated(), device.isCalibratedTimestamps());
+
+  auto path = std::filesystem::temp_directory_path() / "RenderGraphTrace.json";
+  trace.write(path.string());
+  std::ifstream file(path);
+  std::stringstream content;
+  content << file.rdbuf();
+  file.close();
+  std::filesystem::remove(path);
+  auto json = content.str();
+  EXPECT_TRUE(json.starts_with("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  EXPECT_TRUE(json.contains("\"name\":\"Graphics queue\""));
+  EXPECT_TRUE(json.contains("\"name\":\"Compute queue\""));
+  EXPECT_TRUE(json.contains("\"name\":\"Render\",\"cat\":\"cpu\""));
+  EXPECT_TRUE(json.contains("\"name\":\"Render\",\"cat\":\"gpu\""));
+  EXPECT_TRUE(json.contains("\"name\":\"Postprocess\",\"cat\":\"gpu\""));
+  EXPECT_TRUE(json.contains("\"name\":\"Submit\""));
+  EXPECT_TRUE(json.contains("\"name\":\"Wait frame\""));
+  EXPECT_TRUE(json.contains("\"frame\":5}"));
+  EXPECT_FALSE(json.contains("\"frame\":2}"));
+
+  // wait device idle before destroying resources
+  vkDeviceWaitIdle(device.getLogicalDevice());
+}
+
+TEST(ScenarioTest, GraphPipelineStatistics) {
+  glm::ivec2 resolution(1920, 1080);
+  RenderGraph::Instance instance("TestApp", false, true);
+  RenderGraph::Device device(instance);
+  if (device.isPipelineStatistics() == false) GTEST_SKIP() << "pipelineStatisticsQuery isn't supported";
+  RenderGraph::MemoryAllocator allocator(device, instance);
+  int framesInFlight = 2;
+  RenderGraph::Graph graph(4, framesInFlight, device);
+
+  auto commandPool = std::make_shared<RenderGraph::CommandPool>(vkb::QueueType::graphics, device);
+  RenderGraph::CommandBuffer commandBuffer(*commandPool, device);
+  commandBuffer.beginCommands();
+  graph.initialize();
+
+  std::vector<std::shared_ptr<RenderGraph::ImageView>> imageViews;
+  for (int i = 0; i < framesInFlight; i++) {
+    auto image = std::make_unique<RenderGraph::Image>(allocator);
+    image->createImage(VK_FORMAT_R8G8B8A8_UNORM, resolution, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT,
+                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+    image->changeLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_NONE, VK_ACCESS_NONE,
+                        commandBuffer);
+    auto imageView = std::make_shared<RenderGraph::ImageView>(std::move(image), device);
+    imageView->createImageView(VK_IMAGE_VIEW_TYPE_2D, 0, 0);
+    imageViews.push_back(imageView);
+  }
+  graph.getGraphStorage().add("Output", std::make_unique<RenderGraph::ImageViewHolder>(
+                                            imageViews, [&]() { return graph.getFrameInFlight(); }));
+  graph.getGraphStorage().setExported("Output");
+  commandBuffer.endCommands();
+  VkSubmitInfo submitInfo = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &commandBuffer.getCommandBuffer()};
+  vkQueueSubmit(device.getQueue(vkb::QueueType::graphics), 1, &submitInfo, nullptr);
+  vkDeviceWaitIdle(device.getLogicalDevice());
+
+  auto elementMock = std::make_shared<GraphElementMock>();
+  auto& renderPass = graph.createPassGraphic("Render");
+  renderPass.addColorTarget("Output");
+  renderPass.clearTarget("Output");
+  renderPass.registerGraphElement(elementMock);
+  auto& postprocessPass = graph.createPassCompute("Postprocess", true);
+  postprocessPass.addStorageTextureInput("Output");
+  postprocessPass.addStorageTextureOutput("Output");
+  postprocessPass.registerGraphElement(elementMock);
+  // pass recorded in parallel isn't measured
+  auto& parallelPass = graph.createPassCompute("Parallel", false);
+  parallelPass.addStorageTextureInput("Output");
+  parallelPass.addStorageTextureOutput("Output");
+  parallelPass.registerGraphElement(elementMock);
+  parallelPass.setParallelRecording(2);
+  EXPECT_FALSE(graph.isPipelineStatistics());
+  EXPECT_TRUE(graph.getPipelineStatistics().empty());
+  graph.setPipelineStatistics(true);
+  EXPECT_TRUE(graph.isPipelineStatistics());
+  graph.calculate();
+
+  for (int i = 0; i < 3; i++) {
+    graph.render();
+  }
+  vkDeviceWaitIdle(device.getLogicalDevice());
+  uint64_t frame = 0;
+  auto statistics = graph.getPipelineStatistics(&frame);
+  EXPECT_EQ(frame, 3);
+  EXPECT_EQ(statistics.size(), 2);
+  // mock elements don't draw or dispatch anything
+  EXPECT_TRUE(statistics.contains("Render"));
+  EXPECT_EQ(statistics["Render"].vertexInvocations, 0);
+  EXPECT_EQ(statistics["Render"].fragmentInvocations, 0);
+  EXPECT_TRUE(statistics.contains("Postprocess"));
+  EXPECT_EQ(statistics["Postprocess"].computeInvocations, 0);
+  EXPECT_FALSE(statistics.contains("Parallel"));
+
   // wait device idle before destroying resources
   vkDeviceWaitIdle(device.getLogicalDevice());
 }
\ No newline at end of file